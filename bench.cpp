@@ -0,0 +1,405 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <climits>
+#include <iterator>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <clocale>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "summarizer.hpp"
+
+/*
+ * Benchmarks Summarizer on synthetic corpora of filenames. Each corpus is generated deterministically, so that runs
+ * on different builds see exactly the same filenames, then ingested with Summarizer::inputFilename and printed with
+ * Summarizer::printSummary, each timed separately. Every corpus runs in a child process of its own, so that its peak
+ * RSS is its own. Results are printed as one JSON object per line.
+ */
+
+/* a list of filenames, stored back to back */
+struct Corpus
+{
+	std::string bytes; /* every filename, one after another */
+	std::vector<std::size_t> ends; /* where each filename in bytes ends */
+	const char* locale; /* the locale that the filenames are encoded in */
+};
+
+/* xorshift64* generator, so that every platform generates the same corpora */
+class Random
+{
+	public:
+		Random(std::uint64_t seed) : state(seed) {}
+
+		std::uint64_t next()
+		{
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return state * 0x2545F4914F6CDD1DULL;
+		}
+
+		/* @return a number from 0 to bound - 1 */
+		std::uint32_t below(std::uint32_t bound) { return (next() >> 32) % bound; }
+	private:
+		std::uint64_t state;
+};
+
+void appendUtf8(std::string& s, std::uint32_t codePoint)
+{
+	if(codePoint < 0x80)
+	{
+		s.push_back(codePoint);
+	}
+	else if(codePoint < 0x800)
+	{
+		s.push_back(0xC0 | (codePoint >> 6));
+		s.push_back(0x80 | (codePoint & 0x3F));
+	}
+	else if(codePoint < 0x10000)
+	{
+		s.push_back(0xE0 | (codePoint >> 12));
+		s.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+		s.push_back(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		s.push_back(0xF0 | (codePoint >> 18));
+		s.push_back(0x80 | ((codePoint >> 12) & 0x3F));
+		s.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+		s.push_back(0x80 | (codePoint & 0x3F));
+	}
+}
+
+void appendLowercase(std::string& s, Random& random, std::size_t n)
+{
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		s.push_back('a' + random.below(26));
+	}
+}
+
+/* object files, archives and the like from a build tree, e.g. "parser_util-3.o" */
+void generateAscii(Corpus& corpus, std::size_t count)
+{
+	static const char* STEMS[] = {"parser", "lexer", "codegen", "runtime", "alloc", "hash", "io", "net", "util", "test"};
+	static const char* EXTENSIONS[] = {"o", "d", "a", "so", "gcda", "gcno", "pch"};
+	Random random(1);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::string& s = corpus.bytes;
+		s += STEMS[random.below(10)];
+		s += '_';
+		appendLowercase(s, random, 2 + random.below(8));
+		s += '-' + std::to_string(random.below(64));
+		s += '.';
+		s += EXTENSIONS[random.below(7)];
+		corpus.ends.push_back(s.size());
+	}
+}
+
+/* rotated logs, e.g. "syslog.2023-07-14.12.gz" */
+void generateLogs(Corpus& corpus, std::size_t count)
+{
+	static const char* SERVICES[] = {"syslog", "auth", "kern", "nginx-access", "nginx-error", "postgres", "cron"};
+	Random random(2);
+	char date[32];
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::string& s = corpus.bytes;
+		s += SERVICES[random.below(7)];
+		std::snprintf(date, sizeof(date), ".%04u-%02u-%02u.%u", 2015 + random.below(10), 1 + random.below(12),
+		              1 + random.below(28), random.below(100));
+		s += date;
+		if(random.below(4) != 0)
+		{
+			s += ".gz";
+		}
+		corpus.ends.push_back(s.size());
+	}
+}
+
+/* names made of CJK ideographs, e.g. "報告書_二〇二三.txt" */
+void generateCjk(Corpus& corpus, std::size_t count)
+{
+	Random random(3);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::string& s = corpus.bytes;
+		for(std::uint32_t n = 2 + random.below(10); n > 0; --n)
+		{
+			appendUtf8(s, 0x4E00 + random.below(0x9FFF - 0x4E00));
+		}
+		s += '_';
+		for(std::uint32_t n = 1 + random.below(4); n > 0; --n)
+		{
+			appendUtf8(s, 0x4E00 + random.below(64));
+		}
+		s += random.below(2) ? ".txt" : ".md";
+		corpus.ends.push_back(s.size());
+	}
+}
+
+/* Latin letters each followed by several combining marks, some in non-canonical order, so normalization has work */
+void generateCombining(Corpus& corpus, std::size_t count)
+{
+	Random random(4);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::string& s = corpus.bytes;
+		for(std::uint32_t n = 3 + random.below(12); n > 0; --n)
+		{
+			appendUtf8(s, 'a' + random.below(26));
+			for(std::uint32_t marks = random.below(5); marks > 0; --marks)
+			{
+				appendUtf8(s, 0x0300 + random.below(0x70));
+			}
+			if(random.below(8) == 0)
+			{
+				s += '.';
+			}
+		}
+		corpus.ends.push_back(s.size());
+	}
+}
+
+/* traditional Chinese names encoded in Big5, which must be transcoded to and from utf-8 */
+void generateBig5(Corpus& corpus, std::size_t count)
+{
+	Random random(5);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::string& s = corpus.bytes;
+		for(std::uint32_t n = 2 + random.below(8); n > 0; --n)
+		{
+			// the lead bytes 0xA4 to 0xC5 hold the frequently used characters, all of which are assigned
+			s.push_back(0xA4 + random.below(0xC6 - 0xA4));
+			std::uint32_t trail = random.below(0x3F + 0x5E);
+			s.push_back(trail < 0x3F ? 0x40 + trail : 0xA1 + trail - 0x3F);
+		}
+		s += '-' + std::to_string(random.below(1000)) + ".doc";
+		corpus.ends.push_back(s.size());
+	}
+}
+
+/* names nearly FILENAME_MAX bytes long, of ASCII words with the odd accented letter */
+void generateLong(Corpus& corpus, std::size_t count)
+{
+	Random random(6);
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::string& s = corpus.bytes;
+		std::size_t end = s.size() + FILENAME_MAX - 1 - random.below(64);
+		while(s.size() < end - 8)
+		{
+			appendLowercase(s, random, 1 + random.below(7));
+			if(random.below(16) == 0)
+			{
+				appendUtf8(s, 0xE0 + random.below(0x20));
+			}
+			s += random.below(3) ? '_' : '.';
+		}
+		s.resize(end, 'z');
+		corpus.ends.push_back(s.size());
+	}
+}
+
+/* batch outputs under a few long shared prefixes, e.g. "job-2024-03-07-worker-eu-west-2-batch-004512.log" */
+void generatePrefixes(Corpus& corpus, std::size_t count)
+{
+	static const char* REGIONS[] = {"eu-west", "us-east", "ap-south"};
+	Random random(7);
+	char name[96];
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		std::snprintf(name, sizeof(name), "job-2024-%02u-%02u-worker-%s-%u-batch-%06zu.log", 1 + random.below(12),
+		              1 + random.below(28), REGIONS[random.below(3)], 1 + random.below(3), i);
+		corpus.bytes += name;
+		corpus.ends.push_back(corpus.bytes.size());
+	}
+}
+
+/*
+ * Finds a locale to run a corpus in.
+ * @param candidates NULL-terminated names of suitable locales
+ * @return the first candidate which is installed, or NULL if there is none
+ */
+const char* findLocale(const char* const* candidates)
+{
+	for(; *candidates != nullptr; ++candidates)
+	{
+		if(std::setlocale(LC_ALL, *candidates) != nullptr)
+		{
+			return *candidates;
+		}
+	}
+	return nullptr;
+}
+
+double seconds()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/*
+ * Ingests and prints a corpus, and reports how long each took. Meant to run in a child process of its own.
+ * @param name the name of the corpus
+ * @param corpus the filenames
+ * @param delimiters passed on to the Summarizer
+ * @param options passed on to the Summarizer
+ */
+void run(const char* name, const Corpus& corpus, const char* delimiters, const Summarizer::Options& options)
+{
+	std::setlocale(LC_ALL, corpus.locale);
+	Summarizer summarizer(delimiters, options);
+
+	double start = seconds();
+	std::size_t begin = 0;
+	for(auto it = corpus.ends.cbegin(); it != corpus.ends.cend(); ++it)
+	{
+		summarizer.inputFilename(corpus.bytes.data() + begin, *it - begin);
+		begin = *it;
+	}
+	double ingestSeconds = seconds() - start;
+
+	// print into a temporary file instead of the terminal, which would only measure the terminal, and find the size
+	// of the output from it afterwards
+	std::fflush(stdout);
+	int results = dup(STDOUT_FILENO);
+	std::FILE* output = std::tmpfile();
+	if(results < 0 || output == nullptr || dup2(fileno(output), STDOUT_FILENO) < 0)
+	{
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+	start = seconds();
+	int error = summarizer.printSummary();
+	double renderSeconds = seconds() - start;
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+	struct stat status;
+	fstat(STDOUT_FILENO, &status);
+	dup2(results, STDOUT_FILENO);
+
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	double names = corpus.ends.size();
+	double bytes = corpus.bytes.size();
+	std::printf("{\"corpus\": \"%s\", \"locale\": \"%s\", \"names\": %zu, \"bytes\": %zu, "
+	            "\"ingest_seconds\": %.6f, \"ingest_names_per_second\": %.0f, \"ingest_bytes_per_second\": %.0f, "
+	            "\"render_seconds\": %.6f, \"render_names_per_second\": %.0f, \"render_output_bytes\": %lld, "
+	            "\"render_bytes_per_second\": %.0f, \"peak_rss_kilobytes\": %ld}\n",
+	            name, corpus.locale, corpus.ends.size(), corpus.bytes.size(),
+	            ingestSeconds, names / ingestSeconds, bytes / ingestSeconds,
+	            renderSeconds, names / renderSeconds, (long long) status.st_size, status.st_size / renderSeconds,
+	            usage.ru_maxrss);
+	std::fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t count = 200000;
+	if(argc > 1)
+	{
+		char* end;
+		count = std::strtoul(argv[1], &end, 10);
+		if(*end != '\0' || count == 0)
+		{
+			std::fprintf(stderr, "Usage: %s [NAMES]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	static const char* UTF8_LOCALES[] = {"C.UTF-8", "C.utf8", "en_US.UTF-8", "en_US.utf8", nullptr};
+	static const char* BIG5_LOCALES[] = {"zh_TW.BIG5", "zh_TW.Big5", "zh_TW.big5", nullptr};
+	const char* utf8Locale = findLocale(UTF8_LOCALES);
+	const char* big5Locale = findLocale(BIG5_LOCALES);
+
+	struct Benchmark
+	{
+		const char* name; /* the name of the corpus */
+		void (*generate)(Corpus&, std::size_t); /* fills in the corpus */
+		std::size_t count; /* the number of filenames to generate */
+		const char* locale; /* the locale of the corpus, or NULL if none is installed */
+		const char* delimiters; /* the delimiters to split the filenames with */
+		bool sharePrefixes; /* whether the Summarizer reuses the substrings of shared prefixes */
+	};
+	const Benchmark BENCHMARKS[] = {
+		{"ascii", generateAscii, count, utf8Locale, "_-.", false},
+		{"logs", generateLogs, count, utf8Locale, ".-", false},
+		{"cjk", generateCjk, count, utf8Locale, "_.", false},
+		{"combining", generateCombining, count, utf8Locale, ".", false},
+		{"big5", generateBig5, count, big5Locale, "-.", false},
+		{"long", generateLong, count / 100 + 1, utf8Locale, "_.", false},
+		{"prefixes", generatePrefixes, count, utf8Locale, "-.", false},
+		{"prefixes-shared", generatePrefixes, count, utf8Locale, "-.", true}
+	};
+
+	for(auto benchmark = std::begin(BENCHMARKS); benchmark != std::end(BENCHMARKS); ++benchmark)
+	{
+		if(benchmark -> locale == nullptr)
+		{
+			std::printf("{\"corpus\": \"%s\", \"skipped\": \"no suitable locale is installed\"}\n", benchmark -> name);
+			continue;
+		}
+
+		std::fflush(stdout);
+		pid_t child = fork();
+		if(child < 0)
+		{
+			std::perror(nullptr);
+			return EXIT_FAILURE;
+		}
+		if(child == 0)
+		{
+			Corpus corpus;
+			corpus.locale = benchmark -> locale;
+			benchmark -> generate(corpus, benchmark -> count);
+			Summarizer::Options options;
+			options.sharePrefixes = benchmark -> sharePrefixes;
+			run(benchmark -> name, corpus, benchmark -> delimiters, options);
+			std::exit(EXIT_SUCCESS);
+		}
+
+		int status;
+		if(waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+		{
+			std::fprintf(stderr, "%s: benchmark \"%s\" failed\n", argv[0], benchmark -> name);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
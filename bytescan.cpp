@@ -0,0 +1,186 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstdint>
+#include <cstring>
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define BYTESCAN_X86 1
+#endif
+#include "bytescan.hpp"
+
+/* a 64-bit word with every byte set to b */
+#define BYTES(b) (0x0101010101010101ULL * (b))
+
+/*
+ * Checks 8 bytes at a time, then the rest of the bytes one at a time.
+ */
+static bool isPrintableAsciiScalar(const char* s, std::size_t n)
+{
+	std::uint64_t word;
+	for(; n >= 8; s += 8, n -= 8)
+	{
+		std::memcpy(&word, s, 8);
+
+		// a byte is not printable if its high bit is set, if it is below 0x20, or if it is 0x7F
+		std::uint64_t highBit = word & BYTES(0x80);
+		std::uint64_t belowSpace = (word - BYTES(0x20)) & ~word & BYTES(0x80);
+		std::uint64_t isDelete = ((word ^ BYTES(0x7F)) - BYTES(0x01)) & ~(word ^ BYTES(0x7F)) & BYTES(0x80);
+		if(highBit | belowSpace | isDelete)
+		{
+			return false;
+		}
+	}
+
+	for(; n > 0; ++s, --n)
+	{
+		if(*s < 0x20 || *s > 0x7E)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef BYTESCAN_X86
+/*
+ * Checks 16 bytes at a time. As signed bytes, the printable ones are exactly those greater than 0x1F and less
+ * than 0x7F, since bytes with the high bit set are negative.
+ */
+static bool isPrintableAsciiSse2(const char* s, std::size_t n)
+{
+	const __m128i belowPrintable = _mm_set1_epi8(0x1F);
+	const __m128i abovePrintable = _mm_set1_epi8(0x7F);
+	for(; n >= 16; s += 16, n -= 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*) s);
+		__m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, belowPrintable), _mm_cmplt_epi8(bytes, abovePrintable));
+		if(_mm_movemask_epi8(printable) != 0xFFFF)
+		{
+			return false;
+		}
+	}
+	return isPrintableAsciiScalar(s, n);
+}
+
+/*
+ * Same as isPrintableAsciiSse2, but 32 bytes at a time.
+ */
+__attribute__((target("avx2")))
+static bool isPrintableAsciiAvx2(const char* s, std::size_t n)
+{
+	const __m256i belowPrintable = _mm256_set1_epi8(0x1F);
+	const __m256i abovePrintable = _mm256_set1_epi8(0x7F);
+	for(; n >= 32; s += 32, n -= 32)
+	{
+		__m256i bytes = _mm256_loadu_si256((const __m256i*) s);
+		__m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, belowPrintable),
+		                                     _mm256_cmpgt_epi8(abovePrintable, bytes));
+		if((unsigned) _mm256_movemask_epi8(printable) != 0xFFFFFFFF)
+		{
+			return false;
+		}
+	}
+	return isPrintableAsciiSse2(s, n);
+}
+
+/*
+ * Picks the widest implementation that the CPU supports.
+ */
+static bool (*chooseIsPrintableAscii())(const char*, std::size_t)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? isPrintableAsciiAvx2 : isPrintableAsciiSse2;
+}
+
+bool isPrintableAscii(const char* s, std::size_t n)
+{
+	static bool (* const implementation)(const char*, std::size_t) = chooseIsPrintableAscii();
+	return implementation(s, n);
+}
+#else
+bool isPrintableAscii(const char* s, std::size_t n)
+{
+	return isPrintableAsciiScalar(s, n);
+}
+#endif
+
+ByteSet::ByteSet() :
+			memberCount(0)
+{
+	bits[0] = bits[1] = bits[2] = bits[3] = 0;
+}
+
+void ByteSet::add(unsigned char b)
+{
+	if(contains(b))
+	{
+		return;
+	}
+
+	bits[b >> 6] |= 1ULL << (b & 63);
+	if(memberCount < MAX_SIMD_MEMBERS)
+	{
+		members[memberCount] = b;
+	}
+	++memberCount;
+}
+
+std::size_t ByteSet::find(const unsigned char* s, std::size_t n) const
+{
+	std::size_t i = 0;
+#ifdef BYTESCAN_X86
+	if(memberCount <= MAX_SIMD_MEMBERS)
+	{
+		// compare 16 bytes at a time against every member, and stop at the first block with any match
+		__m128i memberVectors[MAX_SIMD_MEMBERS];
+		for(std::size_t m = 0; m < memberCount; ++m)
+		{
+			memberVectors[m] = _mm_set1_epi8((char) members[m]);
+		}
+
+		for(; i + 16 <= n; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*) (s + i));
+			__m128i matches = _mm_setzero_si128();
+			for(std::size_t m = 0; m < memberCount; ++m)
+			{
+				matches = _mm_or_si128(matches, _mm_cmpeq_epi8(bytes, memberVectors[m]));
+			}
+
+			int matchMask = _mm_movemask_epi8(matches);
+			if(matchMask != 0)
+			{
+				return i + __builtin_ctz(matchMask);
+			}
+		}
+	}
+#endif
+
+	for(; i < n; ++i)
+	{
+		if(contains(s[i]))
+		{
+			return i;
+		}
+	}
+	return n;
+}
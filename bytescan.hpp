@@ -0,0 +1,76 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+
+#ifndef BYTESCAN_H
+#define BYTESCAN_H
+
+/*
+ * Checks whether a string consists only of printable ASCII characters, i.e. bytes from 0x20 (' ') up to 0x7E ('~').
+ * Uses AVX2 or SSE2 instructions where the CPU supports them, and otherwise examines 8 bytes at a time.
+ * @param s the string to check. Does not need to be NUL-terminated
+ * @param n the number of bytes in s
+ * @return true if every byte of s is printable ASCII, or s is empty; false otherwise
+ */
+bool isPrintableAscii(const char* s, std::size_t n);
+
+/*
+ * A set of byte values, e.g. single-byte delimiters, which can be searched for in a string.
+ */
+class ByteSet
+{
+	public:
+		/*
+		 * Constructs an empty ByteSet object.
+		 */
+		ByteSet();
+
+		/*
+		 * Adds a byte value to the set.
+		 * @param b the byte value to add
+		 */
+		void add(unsigned char b);
+
+		/*
+		 * @param b a byte value
+		 * @return true if b is in the set; false otherwise
+		 */
+		bool contains(unsigned char b) const { return (bits[b >> 6] >> (b & 63)) & 1; }
+
+		/*
+		 * Finds the first byte in a string which is in the set. Small sets are searched for 16 bytes at a time with
+		 * SSE2 instructions where the CPU supports them.
+		 * @param s the string to search. Does not need to be NUL-terminated
+		 * @param n the number of bytes in s
+		 * @return the index of the first byte of s in the set, or n if there is none
+		 */
+		std::size_t find(const unsigned char* s, std::size_t n) const;
+	private:
+		/* the largest set which is searched for with SIMD instructions, one comparison per member */
+		static const std::size_t MAX_SIMD_MEMBERS = 8;
+
+		unsigned long long bits[4]; /* bit b is set if byte value b is in the set */
+		unsigned char members[MAX_SIMD_MEMBERS]; /* the byte values in the set, if there are few enough */
+		std::size_t memberCount; /* the number of byte values in the set */
+};
+
+#endif /* BYTESCAN_H */
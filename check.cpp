@@ -0,0 +1,505 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unigbrk.h>
+#include <uninorm.h>
+#include <uniwidth.h>
+#include <sys/resource.h>
+#include "segmenter.hpp"
+#include "summarizer.hpp"
+
+/*
+ * Cross-checks the built-in grapheme segmenter, segmentGraphemes, against libunistring's u8_grapheme_breaks and
+ * u8_width: on every code point by itself, before and after a code point of each kind, on every sequence of three code
+ * points of different kinds, on random sequences, and on the test cases of the Unicode Character Database's
+ * GraphemeBreakTest.txt if its path is given. Also checks that the NFC quick check, isQuickNfc, only passes strings
+ * which u8_normalize leaves unchanged, and that isIndependentSplit only allows splits which change neither the
+ * normalization nor the grapheme breaks of a string. Prints the first mismatches found, and exits with EXIT_FAILURE if there are any.
+ * Before all that, checks that a Summarizer's memory use stays flat while filenames keep being added and removed.
+ */
+
+const std::uint32_t CODE_POINTS = 0x110000;
+
+/* the most mismatches that are printed */
+const std::size_t MAX_PRINTED = 20;
+
+std::size_t checked = 0; /* the number of sequences checked */
+std::size_t mismatches = 0; /* the number of those on which segmentGraphemes and libunistring disagree */
+
+/* xorshift64* generator, so that every platform checks the same sequences */
+class Random
+{
+	public:
+		Random(std::uint64_t seed) : state(seed) {}
+
+		std::uint64_t next()
+		{
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return state * 0x2545F4914F6CDD1DULL;
+		}
+
+		/* @return a number from 0 to bound - 1 */
+		std::uint32_t below(std::uint32_t bound) { return (next() >> 32) % bound; }
+	private:
+		std::uint64_t state;
+};
+
+void appendUtf8(std::string& s, std::uint32_t codePoint)
+{
+	if(codePoint < 0x80)
+	{
+		s.push_back(codePoint);
+	}
+	else if(codePoint < 0x800)
+	{
+		s.push_back(0xC0 | (codePoint >> 6));
+		s.push_back(0x80 | (codePoint & 0x3F));
+	}
+	else if(codePoint < 0x10000)
+	{
+		s.push_back(0xE0 | (codePoint >> 12));
+		s.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+		s.push_back(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		s.push_back(0xF0 | (codePoint >> 18));
+		s.push_back(0x80 | ((codePoint >> 12) & 0x3F));
+		s.push_back(0x80 | ((codePoint >> 6) & 0x3F));
+		s.push_back(0x80 | (codePoint & 0x3F));
+	}
+}
+
+/*
+ * @param c a code point
+ * @return whether c can be encoded in utf-8 and is counted by u8_width, i.e. is neither a surrogate nor NUL
+ */
+bool isCheckable(std::uint32_t c)
+{
+	return c != 0 && (c < 0xD800 || c >= 0xE000);
+}
+
+void reportMismatch(const std::vector<std::uint32_t>& codePoints, const char* source, const char* what)
+{
+	if(++mismatches > MAX_PRINTED)
+	{
+		return;
+	}
+	std::printf("%s: %s differ on", source, what);
+	for(auto it = codePoints.cbegin(); it != codePoints.cend(); ++it)
+	{
+		std::printf(" U+%04X", *it);
+	}
+	std::printf("\n");
+}
+
+/*
+ * Segments a sequence of code points with both segmentGraphemes and libunistring, and reports any difference.
+ * @param codePoints the sequence, none of which is a surrogate or NUL
+ * @param source where the sequence came from, to report it by
+ * @param checkWidths whether to compare the widths as well as the grapheme breaks
+ */
+void check(const std::vector<std::uint32_t>& codePoints, const char* source, bool checkWidths = true)
+{
+	std::string s;
+	for(auto it = codePoints.cbegin(); it != codePoints.cend(); ++it)
+	{
+		appendUtf8(s, *it);
+	}
+	const std::uint8_t* bytes = (const std::uint8_t*) s.data();
+	std::size_t n = s.size();
+	std::vector<char> expectedBreaks(n);
+	std::vector<char> breaks(n);
+	std::vector<int> widths(n + 1);
+	++checked;
+
+	u8_grapheme_breaks(bytes, n, expectedBreaks.data());
+	segmentGraphemes(bytes, n, breaks.data(), widths.data(), false);
+	if(breaks != expectedBreaks)
+	{
+		reportMismatch(codePoints, source, "grapheme breaks");
+		return;
+	}
+	if(!checkWidths)
+	{
+		return;
+	}
+
+	static const char* ENCODINGS[] = {"UTF-8", "EUC-JP"};
+	for(int i = 0; i < 2; ++i)
+	{
+		segmentGraphemes(bytes, n, breaks.data(), widths.data(), usesCjkWidths(ENCODINGS[i]));
+		for(std::size_t end = 0; end <= n; ++end)
+		{
+			if((end == n || (bytes[end] & 0xC0) != 0x80) && widths[end] != u8_width(bytes, end, ENCODINGS[i]))
+			{
+				reportMismatch(codePoints, source, i == 0 ? "widths" : "CJK widths");
+				return;
+			}
+		}
+	}
+}
+
+/*
+ * Checks that isQuickNfc only passes a sequence of code points which u8_normalize leaves unchanged, and reports it
+ * otherwise.
+ * @param codePoints the sequence, none of which is a surrogate
+ * @param source where the sequence came from, to report it by
+ * @return whether isQuickNfc passed the sequence
+ */
+bool checkNfc(const std::vector<std::uint32_t>& codePoints, const char* source)
+{
+	std::string s;
+	for(auto it = codePoints.cbegin(); it != codePoints.cend(); ++it)
+	{
+		appendUtf8(s, *it);
+	}
+	++checked;
+	if(!isQuickNfc((const std::uint8_t*) s.data(), s.size()))
+	{
+		return false;
+	}
+
+	std::uint8_t buffer[256];
+	std::size_t length = sizeof(buffer);
+	std::uint8_t* result = u8_normalize(UNINORM_NFC, (const std::uint8_t*) s.data(), s.size(), buffer, &length);
+	if(result == nullptr)
+	{
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+	if(length != s.size() || std::memcmp(result, s.data(), length) != 0)
+	{
+		reportMismatch(codePoints, source, "normalizations");
+	}
+	if(result != buffer)
+	{
+		std::free(result);
+	}
+	return true;
+}
+
+/*
+ * @param s a utf-8 string
+ * @param n the number of bytes in s
+ * @return s normalized to NFC
+ */
+std::string normalize(const std::uint8_t* s, std::size_t n)
+{
+	std::size_t length;
+	std::uint8_t* result = u8_normalize(UNINORM_NFC, s, n, nullptr, &length);
+	if(result == nullptr)
+	{
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+	std::string normalized((const char*) result, length);
+	std::free(result);
+	return normalized;
+}
+
+/*
+ * Checks that wherever isIndependentSplit allows a sequence of code points to be split, normalizing the two parts and
+ * finding their grapheme breaks separately gives the same result as for the whole sequence, and reports it otherwise.
+ * @param codePoints the sequence, none of which is a surrogate
+ * @param source where the sequence came from, to report it by
+ */
+void checkSplits(const std::vector<std::uint32_t>& codePoints, const char* source)
+{
+	std::string s;
+	for(auto it = codePoints.cbegin(); it != codePoints.cend(); ++it)
+	{
+		appendUtf8(s, *it);
+	}
+	const std::uint8_t* bytes = (const std::uint8_t*) s.data();
+	++checked;
+
+	std::string whole = normalize(bytes, s.size());
+	std::vector<char> expectedBreaks(whole.size());
+	u8_grapheme_breaks((const std::uint8_t*) whole.data(), whole.size(), expectedBreaks.data());
+	for(std::size_t split = 1; split < s.size(); ++split)
+	{
+		if((bytes[split] & 0xC0) == 0x80 || !isIndependentSplit(bytes, s.size(), split))
+		{
+			continue;
+		}
+
+		std::string parts = normalize(bytes, split);
+		std::size_t firstLength = parts.size();
+		parts += normalize(bytes + split, s.size() - split);
+		std::vector<char> breaks(parts.size());
+		u8_grapheme_breaks((const std::uint8_t*) parts.data(), firstLength, breaks.data());
+		u8_grapheme_breaks((const std::uint8_t*) parts.data() + firstLength, parts.size() - firstLength,
+		                   breaks.data() + firstLength);
+		if(parts != whole || breaks != expectedBreaks)
+		{
+			reportMismatch(codePoints, source, "splits");
+			return;
+		}
+	}
+}
+
+/*
+ * Adds and then removes a round of filenames which are all different, again and again, like the files passing through
+ * a busy spool directory under --watch, and checks that the peak memory use of the process levels off, however many
+ * times they come and go.
+ * Must run before anything else, so that the peak is the Summarizer's own.
+ * @return whether the peak memory use stopped growing after the first rounds
+ */
+bool checkChurn()
+{
+	const std::size_t ROUNDS = 24;
+	const std::size_t WARM_ROUNDS = 8;
+	const std::size_t NAMES_PER_ROUND = 200000;
+	Summarizer summarizer("_");
+	std::vector<long> peaks;
+
+	// the same names every round, so that they take the same space each time they are added
+	std::vector<std::string> names;
+	for(std::size_t i = 0; i < NAMES_PER_ROUND; ++i)
+	{
+		names.push_back("spool_" + std::to_string(1000000 + i) + "_x");
+	}
+	for(std::size_t round = 0; round < ROUNDS; ++round)
+	{
+		for(auto it = names.cbegin(); it != names.cend(); ++it)
+		{
+			summarizer.inputFilename(it -> data(), it -> size());
+		}
+		for(auto it = names.cbegin(); it != names.cend(); ++it)
+		{
+			summarizer.removeFilename(it -> data(), it -> size());
+		}
+
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		peaks.push_back(usage.ru_maxrss);
+	}
+
+	// the first rounds grow the sets' hash tables and the arena to their working size, after which the peak should
+	// only move by the allocator's slack
+	long warmPeak = peaks[WARM_ROUNDS - 1];
+	std::printf("churn: peak memory %ld kB after %zu rounds of %zu filenames, %ld kB after %zu\n", warmPeak,
+	            WARM_ROUNDS, NAMES_PER_ROUND, peaks.back(), ROUNDS);
+	return peaks.back() - warmPeak <= warmPeak / 10;
+}
+
+/*
+ * Checks the test cases of GraphemeBreakTest.txt, e.g. "÷ 0020 × 0308 ÷ 0020 ÷". libunistring may implement an older
+ * version of Unicode than the file is from, so the segmenters are only checked against each other, and the cases that
+ * libunistring itself gets wrong are only counted.
+ * @param path the path of GraphemeBreakTest.txt
+ * @return false if the file could not be read
+ */
+bool checkTestFile(const char* path)
+{
+	std::FILE* file = std::fopen(path, "r");
+	if(file == nullptr)
+	{
+		return false;
+	}
+
+	std::size_t cases = 0;
+	std::size_t outdated = 0;
+	char line[4096];
+	while(std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		// the rest of a line from a '#' is a comment
+		line[std::strcspn(line, "#")] = '\0';
+		std::vector<std::uint32_t> codePoints;
+		std::string expected; // 1 if a grapheme cluster begins at each code point, or else 0
+		bool pendingBreak = false;
+		bool checkable = true;
+		for(char* token = std::strtok(line, " \t\n"); token != nullptr; token = std::strtok(nullptr, " \t\n"))
+		{
+			if(std::strcmp(token, "\xC3\xB7") == 0 || std::strcmp(token, "\xC3\x97") == 0)
+			{
+				pendingBreak = token[1] == '\xB7';
+				continue;
+			}
+			std::uint32_t c = std::strtoul(token, nullptr, 16);
+			checkable = checkable && isCheckable(c);
+			codePoints.push_back(c);
+			expected.push_back(pendingBreak || codePoints.size() == 1 ? '1' : '0');
+		}
+		if(codePoints.empty() || !checkable)
+		{
+			continue;
+		}
+
+		++cases;
+		check(codePoints, path);
+		std::string s;
+		for(auto it = codePoints.cbegin(); it != codePoints.cend(); ++it)
+		{
+			appendUtf8(s, *it);
+		}
+		std::vector<char> breaks(s.size());
+		u8_grapheme_breaks((const std::uint8_t*) s.data(), s.size(), breaks.data());
+		std::string actual;
+		for(std::size_t i = 0; i < s.size(); ++i)
+		{
+			if((s[i] & 0xC0) != 0x80)
+			{
+				actual.push_back(breaks[i] ? '1' : '0');
+			}
+		}
+		outdated += actual != expected;
+	}
+	std::fclose(file);
+	std::printf("%s: %zu test cases, of which libunistring disagrees with %zu\n", path, cases, outdated);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc > 2)
+	{
+		std::fprintf(stderr, "Usage: %s [GraphemeBreakTest.txt]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bool churnFlat = checkChurn();
+	if(!churnFlat)
+	{
+		std::printf("memory use kept growing while filenames were added and removed\n");
+	}
+
+	// a code point of each grapheme cluster break property, both narrow and wide, and a couple of emoji
+	std::vector<std::uint32_t> kinds;
+	std::vector<bool> seen(2 * (GRAPHEME_BREAK_MASK + 1));
+	for(std::uint32_t c = 1; c < CODE_POINTS; ++c)
+	{
+		std::size_t kind = uc_graphemeclusterbreak_property(c) * 2 + (uc_width(c, "UTF-8") == 2);
+		if(isCheckable(c) && !seen[kind])
+		{
+			seen[kind] = true;
+			kinds.push_back(c);
+		}
+	}
+	kinds.push_back(0x1F600); // GRINNING FACE, which is Extended_Pictographic
+	kinds.push_back(0x00A9); // COPYRIGHT SIGN, which is too, but only 1 column wide
+
+	// every code point by itself and next to each kind
+	for(std::uint32_t c = 1; c < CODE_POINTS; ++c)
+	{
+		if(!isCheckable(c))
+		{
+			continue;
+		}
+		check({c}, "single code points");
+		for(auto it = kinds.cbegin(); it != kinds.cend(); ++it)
+		{
+			check({*it, c}, "pairs of code points", false);
+			check({c, *it}, "pairs of code points", false);
+		}
+	}
+
+	// every sequence of three kinds
+	for(auto a = kinds.cbegin(); a != kinds.cend(); ++a)
+	{
+		for(auto b = kinds.cbegin(); b != kinds.cend(); ++b)
+		{
+			for(auto c = kinds.cbegin(); c != kinds.cend(); ++c)
+			{
+				check({*a, *b, *c}, "sequences of three kinds");
+				checkSplits({*a, *b, *c}, "sequences of three kinds");
+			}
+		}
+	}
+
+	// random sequences, mostly of the kinds, and of emoji, regional indicators, Hangul and combining marks
+	Random random(1);
+	static const std::uint32_t EXTRAS[] = {0x200D, 0x1F1E6, 0x1F1FA, 0x1F468, 0x1F3FB, 0xFE0F, 0x1100, 0x1161, 0x11A8,
+	                                       0xAC00, 0xAC01, 0x0301, 0x0903, 0x0600, 0x000D, 0x000A, 0x0915, 0x094D};
+	const std::size_t extraCount = sizeof(EXTRAS) / sizeof(EXTRAS[0]);
+	for(int i = 0; i < 200000; ++i)
+	{
+		std::vector<std::uint32_t> codePoints;
+		for(std::uint32_t length = 1 + random.below(12); length > 0; --length)
+		{
+			std::uint32_t choice = random.below(kinds.size() + extraCount + 4);
+			std::uint32_t c = choice < kinds.size() ? kinds[choice] :
+			                  choice < kinds.size() + extraCount ? EXTRAS[choice - kinds.size()] :
+			                  1 + random.below(CODE_POINTS - 1);
+			if(isCheckable(c))
+			{
+				codePoints.push_back(c);
+			}
+		}
+		check(codePoints, "random sequences");
+		checkSplits(codePoints, "random sequences");
+	}
+
+	// every code point by itself and after starters which compose with marks, and random sequences of combining marks
+	// of different classes after such starters
+	static const std::uint32_t STARTERS[] = {'a', 'e', 'o', 'u', 0x00C5, 0x0391, 0x0415, 0x05D0, 0x0915, 0x0B47, 0x0BC6,
+	                                         0x0CC6, 0x0D46, 0x0DD9, 0x1025, 0x1100, 0xAC00, 0xAC01, 0x3046, 0x110A5};
+	static const std::uint32_t MARKS[] = {0x0300, 0x0301, 0x0308, 0x0316, 0x031B, 0x0323, 0x0327, 0x0334, 0x0345,
+	                                      0x05B0, 0x093C, 0x094D, 0x0B3E, 0x0BBE, 0x0CD5, 0x0D3E, 0x0DCF, 0x102E,
+	                                      0x1161, 0x11A8, 0x3099, 0x110BA, 0x0344, 0x0F73, 0x1D165};
+	const std::size_t starterCount = sizeof(STARTERS) / sizeof(STARTERS[0]);
+	const std::size_t markCount = sizeof(MARKS) / sizeof(MARKS[0]);
+	std::size_t quick = 0;
+	std::size_t codePoints = 0;
+	for(std::uint32_t c = 0; c < CODE_POINTS; ++c)
+	{
+		if(c < 0xD800 || c >= 0xE000)
+		{
+			++codePoints;
+			quick += checkNfc({c}, "single code points");
+			for(std::size_t i = 0; i < starterCount; ++i)
+			{
+				checkNfc({STARTERS[i], c}, "code points after starters");
+			}
+			checkSplits({STARTERS[c % starterCount], c, MARKS[c % markCount]}, "code points between starters and marks");
+		}
+	}
+	for(int i = 0; i < 200000; ++i)
+	{
+		std::vector<std::uint32_t> sequence = {STARTERS[random.below(starterCount)]};
+		for(std::uint32_t length = random.below(5); length > 0; --length)
+		{
+			sequence.push_back(MARKS[random.below(markCount)]);
+		}
+		checkNfc(sequence, "random sequences of marks");
+		sequence.push_back(STARTERS[random.below(starterCount)]);
+		sequence.push_back(MARKS[random.below(markCount)]);
+		checkSplits(sequence, "random sequences of marks");
+	}
+	std::printf("%zu of %zu code points pass the NFC quick check by themselves\n", quick, codePoints);
+
+	if(argc == 2 && !checkTestFile(argv[1]))
+	{
+		std::printf("%s not found, so only generated sequences were checked\n", argv[1]);
+	}
+
+	std::printf("%zu sequences checked, %zu mismatches\n", checked, mismatches);
+	return mismatches == 0 && churnFlat ? EXIT_SUCCESS : EXIT_FAILURE;
+}
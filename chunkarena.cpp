@@ -0,0 +1,76 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include "chunkarena.hpp"
+
+ChunkArena::~ChunkArena()
+{
+	for(auto it = blocks.begin(); it != blocks.end(); ++it)
+	{
+		std::free(*it);
+	}
+}
+
+ChunkArena::Handle ChunkArena::append(const std::uint8_t* s, std::size_t n, int width)
+{
+	if(blocks.empty() || blockCapacity - blockUsed < n)
+	{
+		// start a new block, making it bigger than usual if this chunk would not fit in a regular one
+		blockCapacity = n > BLOCK_SIZE ? n : BLOCK_SIZE;
+		std::uint8_t* block = (std::uint8_t*) std::malloc(blockCapacity);
+		if(block == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		blocks.push_back(block);
+		blockUsed = 0;
+	}
+
+	Handle handle;
+	handle.block = blocks.size() - 1;
+	handle.offset = blockUsed;
+	handle.length = n;
+	handle.width = width;
+
+	std::memcpy(blocks.back() + blockUsed, s, n);
+	blockUsed += n;
+	appendedBytes += n;
+	return handle;
+}
+
+void ChunkArena::swap(ChunkArena& other)
+{
+	blocks.swap(other.blocks);
+	std::swap(blockUsed, other.blockUsed);
+	std::swap(blockCapacity, other.blockCapacity);
+	std::swap(appendedBytes, other.appendedBytes);
+	std::swap(releasedBytes, other.releasedBytes);
+}
+
+bool ChunkComparator::operator()(const ChunkArena::Handle& lhs, const ChunkArena::Handle& rhs) const
+{
+	int result = std::memcmp(arena -> data(lhs), arena -> data(rhs), lhs.length < rhs.length ? lhs.length : rhs.length);
+	return result < 0 || (result == 0 && lhs.length < rhs.length);
+}
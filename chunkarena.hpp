@@ -0,0 +1,126 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef CHUNKARENA_H
+#define CHUNKARENA_H
+
+/*
+ * Append-only storage for the substrings ("chunks") of the pattern. Chunks are copied back to back into large blocks
+ * of memory, which are never moved or freed until the arena is destroyed, and are referred to by small handles
+ * instead of pointers. This replaces a separate heap allocation per chunk with one allocation per block.
+ * A chunk which is no longer needed is only counted as released; once enough are, the owner of the arena can copy the
+ * chunks still in use to a new arena, and swap it in place of this one.
+ */
+class ChunkArena
+{
+	public:
+		/*
+		 * Refers to a chunk stored in a ChunkArena, and records its display width.
+		 */
+		struct Handle
+		{
+			std::uint32_t block; /* the index of the block holding the chunk */
+			std::uint32_t offset; /* the offset of the chunk's first byte in that block */
+			std::uint32_t length; /* the number of bytes in the chunk */
+			int width; /* the number of columns required to display the chunk on a terminal */
+		};
+
+		/*
+		 * Constructs an empty ChunkArena object. No memory is allocated until the first chunk is appended.
+		 */
+		ChunkArena() : blockUsed(0), blockCapacity(0), appendedBytes(0), releasedBytes(0) {}
+
+		/*
+		 * Frees every block.
+		 */
+		~ChunkArena();
+
+		ChunkArena(const ChunkArena&) = delete;
+		ChunkArena& operator=(const ChunkArena&) = delete;
+
+		/*
+		 * Copies a chunk into the arena.
+		 * Throws std::bad_alloc if there is an error in block allocation.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @param width the number of columns required to display the chunk on a terminal
+		 * @return a handle to the copy of the chunk
+		 */
+		Handle append(const std::uint8_t* s, std::size_t n, int width);
+
+		/*
+		 * @param handle a handle returned by ChunkArena::append
+		 * @return a pointer to the first byte of the chunk
+		 */
+		const std::uint8_t* data(const Handle& handle) const { return blocks[handle.block] + handle.offset; }
+
+		/*
+		 * Counts a chunk's bytes as no longer in use. They stay where they are until the arena is destroyed.
+		 * @param handle a handle returned by ChunkArena::append, which must not be released more than once
+		 */
+		void release(const Handle& handle) { releasedBytes += handle.length; }
+
+		/*
+		 * @return the number of bytes of all the chunks appended so far, including released ones
+		 */
+		std::size_t getAppendedBytes() const { return appendedBytes; }
+
+		/*
+		 * @return the number of bytes of all the chunks released so far
+		 */
+		std::size_t getReleasedBytes() const { return releasedBytes; }
+
+		/*
+		 * Exchanges the chunks of two arenas, so that handles into either one refer to the other one afterwards.
+		 * @param other the arena to exchange chunks with
+		 */
+		void swap(ChunkArena& other);
+	private:
+		/* the size of each block, unless a chunk longer than this needs a block of its own */
+		static const std::size_t BLOCK_SIZE = 1 << 16;
+
+		std::vector<std::uint8_t*> blocks; /* every block allocated so far. Only the last one is appended to */
+		std::size_t blockUsed; /* the number of bytes in use in the last block */
+		std::size_t blockCapacity; /* the size of the last block */
+		std::size_t appendedBytes; /* the number of bytes of all the chunks appended */
+		std::size_t releasedBytes; /* the number of bytes of all the chunks released */
+};
+
+/*
+ * A comparison function object for handles to chunks in the same ChunkArena. Compares the bytes of the chunks.
+ */
+struct ChunkComparator
+{
+	const ChunkArena* arena; /* the arena holding the chunks being compared */
+
+	/*
+	 * @param lhs a handle to the first chunk
+	 * @param rhs a handle to the second chunk
+	 * @return true if lhs's chunk comes lexicographically before rhs's chunk; false otherwise
+	 */
+	bool operator()(const ChunkArena::Handle& lhs, const ChunkArena::Handle& rhs) const;
+};
+
+#endif /* CHUNKARENA_H */
@@ -0,0 +1,220 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <algorithm>
+#include <cstring>
+#include "chunkcolumn.hpp"
+
+ChunkColumn::Probe ChunkColumn::probe(const std::uint8_t* s, std::size_t n)
+{
+	// keep the table at most half full, so that probe sequences stay short. This is done ahead of time, so that
+	// the empty slot found for a new chunk is still where it goes once it is added
+	if(2 * (handles.size() + 1) > slots.size())
+	{
+		grow();
+	}
+
+	Probe result;
+	result.found = false;
+	result.tag = hash(s, n) >> 32;
+	result.position = result.tag & mask;
+	while(slots[result.position] != 0)
+	{
+		if(slots[result.position] >> 32 == result.tag)
+		{
+			// only compare the bytes of chunks whose hashes are (probably) the same
+			const ChunkArena::Handle& handle = handles[indexOf(result)];
+			if(handle.length == n && std::memcmp(arena -> data(handle), s, n) == 0)
+			{
+				result.found = true;
+				break;
+			}
+		}
+		result.position = (result.position + 1) & mask;
+	}
+	return result;
+}
+
+bool ChunkColumn::contains(const std::uint8_t* s, std::size_t n, std::uint64_t chunkHash) const
+{
+	if(slots.empty())
+	{
+		return false;
+	}
+
+	std::uint64_t tag = chunkHash >> 32;
+	for(std::size_t position = tag & mask; slots[position] != 0; position = (position + 1) & mask)
+	{
+		if(slots[position] >> 32 == tag)
+		{
+			const ChunkArena::Handle& handle = handles[(slots[position] & 0xFFFFFFFF) - 1];
+			if(handle.length == n && std::memcmp(arena -> data(handle), s, n) == 0)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ChunkColumn::add(const Probe& probe, const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences)
+{
+	handles.push_back(arena -> append(s, n, width));
+	counts.push_back(occurrences);
+	slots[probe.position] = (probe.tag << 32) | handles.size();
+}
+
+bool ChunkColumn::insert(const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences)
+{
+	Probe result = probe(s, n);
+	if(result.found)
+	{
+		addOccurrences(result, occurrences);
+		return false;
+	}
+
+	add(result, s, n, width, occurrences);
+	return true;
+}
+
+bool ChunkColumn::removeOccurrences(const Probe& probe, std::size_t occurrences)
+{
+	std::size_t index = indexOf(probe);
+	if(counts[index] > occurrences)
+	{
+		counts[index] -= occurrences;
+		return false;
+	}
+
+	// empty the chunk's slot, then move back any later slot of the same run which would no longer be reachable from
+	// where its hash points to
+	std::size_t position = probe.position;
+	slots[position] = 0;
+	for(std::size_t next = (position + 1) & mask; slots[next] != 0; next = (next + 1) & mask)
+	{
+		std::size_t home = (slots[next] >> 32) & mask;
+		if(((next - home) & mask) >= ((next - position) & mask))
+		{
+			slots[position] = slots[next];
+			slots[next] = 0;
+			position = next;
+		}
+	}
+
+	arena -> release(handles[index]);
+
+	// fill the chunk's place in handles with the last chunk, whose slot then has to point to its new index
+	std::size_t last = handles.size() - 1;
+	if(index != last)
+	{
+		const ChunkArena::Handle& moved = handles[last];
+		position = (hash(arena -> data(moved), moved.length) >> 32) & mask;
+		while((slots[position] & 0xFFFFFFFF) != last + 1)
+		{
+			position = (position + 1) & mask;
+		}
+		slots[position] = (slots[position] & ~0xFFFFFFFFULL) | (index + 1);
+
+		handles[index] = moved;
+		counts[index] = counts[last];
+	}
+	handles.pop_back();
+	counts.pop_back();
+	return true;
+}
+
+void ChunkColumn::clear()
+{
+	for(auto it = handles.cbegin(); it != handles.cend(); ++it)
+	{
+		arena -> release(*it);
+	}
+	std::vector<ChunkArena::Handle>().swap(handles);
+	std::vector<std::size_t>().swap(counts);
+	std::vector<std::uint64_t>().swap(slots);
+	mask = 0;
+}
+
+void ChunkColumn::copyChunks(ChunkArena& destination, std::vector<ChunkArena::Handle>& copies) const
+{
+	// the chunks keep their indices and hashes, so the hash table stays valid for the copies
+	copies.clear();
+	copies.reserve(handles.size());
+	for(auto it = handles.cbegin(); it != handles.cend(); ++it)
+	{
+		copies.push_back(destination.append(arena -> data(*it), it -> length, it -> width));
+	}
+}
+
+void ChunkColumn::sortedHandles(std::vector<ChunkArena::Handle>& sorted) const
+{
+	sorted.assign(handles.begin(), handles.end());
+	std::sort(sorted.begin(), sorted.end(), ChunkComparator{arena});
+}
+
+std::uint64_t ChunkColumn::hash(const std::uint8_t* s, std::size_t n)
+{
+	// multiply-and-mix over 8 bytes at a time, followed by the finalizer of MurmurHash3
+	const std::uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+	std::uint64_t h = n * MULTIPLIER;
+	std::uint64_t word;
+
+	for(; n >= 8; s += 8, n -= 8)
+	{
+		std::memcpy(&word, s, 8);
+		h = (h ^ word) * MULTIPLIER;
+		h ^= h >> 29;
+	}
+	if(n > 0)
+	{
+		word = 0;
+		std::memcpy(&word, s, n);
+		h = (h ^ word) * MULTIPLIER;
+		h ^= h >> 29;
+	}
+
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+void ChunkColumn::grow()
+{
+	std::vector<std::uint64_t> oldSlots(slots.empty() ? MIN_SLOTS : 2 * slots.size(), 0);
+	oldSlots.swap(slots);
+	mask = slots.size() - 1;
+
+	for(auto it = oldSlots.begin(); it != oldSlots.end(); ++it)
+	{
+		if(*it != 0)
+		{
+			std::size_t position = (*it >> 32) & mask;
+			while(slots[position] != 0)
+			{
+				position = (position + 1) & mask;
+			}
+			slots[position] = *it;
+		}
+	}
+}
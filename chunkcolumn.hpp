@@ -0,0 +1,200 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chunkarena.hpp"
+
+#ifndef CHUNKCOLUMN_H
+#define CHUNKCOLUMN_H
+
+/*
+ * A set of unique chunks, i.e. one column of the pattern. Chunks are found by an open-addressing hash table of their
+ * bytes, so checking whether a chunk is already in the column usually costs one hash computation and one probe of a
+ * flat array, with no allocation. The chunks are kept in the order they were inserted; they are only sorted when
+ * asked for by ChunkColumn::sortedHandles, e.g. when the pattern is printed. The number of occurrences of each chunk
+ * is counted alongside it.
+ */
+class ChunkColumn
+{
+	public:
+		/*
+		 * Constructs an empty ChunkColumn object.
+		 * @param _arena the arena that the column's chunks are stored in
+		 */
+		ChunkColumn(ChunkArena* _arena) : arena(_arena), mask(0) {}
+
+		/*
+		 * The result of looking up a chunk with ChunkColumn::probe.
+		 */
+		struct Probe
+		{
+			bool found; /* whether the chunk is already in the column */
+			std::size_t position; /* the chunk's slot in the hash table, or the empty slot it would be added at */
+			std::uint64_t tag; /* the part of the chunk's hash stored in the hash table */
+		};
+
+		/*
+		 * Looks a chunk up in the column, without copying or storing anything, so that any further work for a new
+		 * chunk (e.g. computing its width) can be skipped for a duplicate.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @return where the chunk is in the hash table, or where it would be added by ChunkColumn::add
+		 */
+		Probe probe(const std::uint8_t* s, std::size_t n);
+
+		/*
+		 * Checks whether a chunk is in the column, without changing anything. Takes the chunk's hash, so that it only
+		 * needs to be computed once to look the chunk up in several columns.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @param chunkHash the hash of the chunk, as computed by ChunkColumn::hash
+		 * @return whether the chunk is in the column
+		 */
+		bool contains(const std::uint8_t* s, std::size_t n, std::uint64_t chunkHash) const;
+
+		/*
+		 * Adds a chunk which was not found by ChunkColumn::probe to the column, copying it into the column's arena.
+		 * The column must not have been changed since the chunk was probed for.
+		 * @param probe the result of probing for the chunk
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @param width the number of columns required to display the chunk on a terminal
+		 * @param occurrences the number of times the chunk occurred
+		 */
+		void add(const Probe& probe, const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences = 1);
+
+		/*
+		 * Counts more occurrences of a chunk which was found by ChunkColumn::probe.
+		 * @param probe the result of probing for the chunk
+		 * @param occurrences the number of times the chunk occurred again
+		 */
+		void addOccurrences(const Probe& probe, std::size_t occurrences = 1) { counts[indexOf(probe)] += occurrences; }
+
+		/*
+		 * Counts more occurrences of a chunk which is known to be in the column, without looking it up.
+		 * @param index the index of the chunk in ChunkColumn::getHandles
+		 * @param occurrences the number of times the chunk occurred again
+		 */
+		void addOccurrencesAt(std::size_t index, std::size_t occurrences = 1) { counts[index] += occurrences; }
+
+		/*
+		 * @param probe the result of probing for a chunk which was found
+		 * @return the index of the chunk in ChunkColumn::getHandles
+		 */
+		std::size_t indexOf(const Probe& probe) const { return (slots[probe.position] & 0xFFFFFFFF) - 1; }
+
+		/*
+		 * Adds a chunk to the column, unless an identical chunk is already in it, in which case only its number of
+		 * occurrences goes up. A new chunk is copied into the column's arena.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @param width the number of columns required to display the chunk on a terminal
+		 * @param occurrences the number of times the chunk occurred
+		 * @return true if the chunk was added; false if it was already in the column
+		 */
+		bool insert(const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences = 1);
+
+		/*
+		 * Forgets occurrences of a chunk which was found by ChunkColumn::probe. Once no occurrences are left, the
+		 * chunk is taken out of the column, and its bytes are released in the arena (see ChunkArena::release).
+		 * @param probe the result of probing for the chunk
+		 * @param occurrences the number of occurrences to forget
+		 * @return true if the chunk was taken out of the column; false if it still has occurrences left
+		 */
+		bool removeOccurrences(const Probe& probe, std::size_t occurrences = 1);
+
+		/*
+		 * @param probe the result of probing for a chunk which was found
+		 * @return the handle to the chunk's bytes
+		 */
+		const ChunkArena::Handle& getHandle(const Probe& probe) const { return handles[indexOf(probe)]; }
+
+		/*
+		 * Empties the column, and frees its hash table. The chunks' bytes are released in the arena.
+		 */
+		void clear();
+
+		/*
+		 * Copies the bytes of every chunk in the column to another arena, without changing the column.
+		 * Throws std::bad_alloc if there is an error in block allocation.
+		 * @param destination the arena to copy the chunks to
+		 * @param copies set to handles to the copies, in the same order as ChunkColumn::getHandles
+		 */
+		void copyChunks(ChunkArena& destination, std::vector<ChunkArena::Handle>& copies) const;
+
+		/*
+		 * Points the column's handles at copies of its chunks made by ChunkColumn::copyChunks. The column's own arena
+		 * must then be swapped with the one the copies are in (see ChunkArena::swap), after which the handles refer
+		 * to the same bytes in the column's own arena again.
+		 * @param copies the handles to the copies. Left with the column's old handles
+		 */
+		void replaceHandles(std::vector<ChunkArena::Handle>& copies) { handles.swap(copies); }
+
+		/*
+		 * @return the number of unique chunks in the column
+		 */
+		std::size_t size() const { return handles.size(); }
+
+		/*
+		 * @return handles to every chunk in the column, in the order they were added
+		 */
+		const std::vector<ChunkArena::Handle>& getHandles() const { return handles; }
+
+		/*
+		 * @return the number of occurrences of every chunk in the column, in the same order as ChunkColumn::getHandles
+		 */
+		const std::vector<std::size_t>& getCounts() const { return counts; }
+
+		/*
+		 * Puts handles to every chunk in the column in lexicographic order of the chunks' bytes.
+		 * @param sorted set to the sorted handles
+		 */
+		void sortedHandles(std::vector<ChunkArena::Handle>& sorted) const;
+
+		/*
+		 * Computes the hash of a chunk's bytes, as used to find chunks in a ChunkColumn.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @return the hash of the chunk
+		 */
+		static std::uint64_t hash(const std::uint8_t* s, std::size_t n);
+	private:
+		/* the smallest number of slots in the hash table, once it has any */
+		static const std::size_t MIN_SLOTS = 16;
+
+		ChunkArena* arena; /* the arena holding the bytes of the chunks */
+		std::vector<ChunkArena::Handle> handles; /* the chunks in the column, in the order they were added */
+		std::vector<std::size_t> counts; /* the number of occurrences of each chunk in handles */
+
+		/* the hash table. Each non-zero slot holds the upper 32 bits of a chunk's hash in its own upper 32 bits, and
+		   1 + the index of the chunk in handles in its lower 32 bits. Zero marks an empty slot */
+		std::vector<std::uint64_t> slots;
+		std::size_t mask; /* slots.size() - 1, used to wrap around the table */
+
+		/*
+		 * Doubles the size of the hash table, re-inserting every slot using the part of the hash stored in it.
+		 */
+		void grow();
+};
+
+#endif /* CHUNKCOLUMN_H */
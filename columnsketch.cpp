@@ -0,0 +1,295 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cmath>
+#include <cstring>
+#include "columnsketch.hpp"
+#include "chunkcolumn.hpp"
+
+ColumnSketch::ColumnSketch(std::size_t _capacity) :
+			capacity(_capacity),
+			registers(1 << REGISTER_BITS, 0)
+{
+	// keep the hash table at most half full
+	std::size_t slotCount = 16;
+	while(slotCount < 2 * capacity)
+	{
+		slotCount *= 2;
+	}
+	slots.assign(slotCount, 0);
+	mask = slotCount - 1;
+
+	counters.reserve(capacity);
+	heap.reserve(capacity);
+}
+
+ColumnSketch::Probe ColumnSketch::probe(const std::uint8_t* s, std::size_t n) const
+{
+	Probe result;
+	result.found = false;
+	result.hash = ChunkColumn::hash(s, n);
+	result.position = result.hash & mask;
+	while(slots[result.position] != 0)
+	{
+		const Counter& counter = counters[slots[result.position] - 1];
+		if(counter.hash == result.hash && counter.chunk.size() == n && std::memcmp(counter.chunk.data(), s, n) == 0)
+		{
+			result.found = true;
+			break;
+		}
+		result.position = (result.position + 1) & mask;
+	}
+	return result;
+}
+
+void ColumnSketch::addOccurrences(const Probe& probe, std::size_t occurrences, std::size_t error)
+{
+	countUnique(probe.hash);
+
+	Counter& counter = counters[slots[probe.position] - 1];
+	counter.count += occurrences;
+	counter.error += error;
+	siftDown(counter.heapPosition);
+}
+
+void ColumnSketch::add(const Probe& probe, const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences,
+                       std::size_t error)
+{
+	countUnique(probe.hash);
+
+	if(counters.size() < capacity)
+	{
+		// there is still room to monitor another chunk
+		Counter counter;
+		counter.chunk.assign(s, n);
+		counter.width = width;
+		counter.hash = probe.hash;
+		counter.count = occurrences;
+		counter.error = error;
+		counter.heapPosition = heap.size();
+		counters.push_back(counter);
+
+		heap.push_back(counters.size() - 1);
+		slots[findEmptySlot(probe.hash)] = counters.size();
+		siftUp(heap.size() - 1);
+		return;
+	}
+
+	// replace the chunk with the lowest count, which may have occurred as often as this one without being seen
+	std::size_t index = heap.front();
+	removeSlot(index);
+
+	Counter& counter = counters[index];
+	std::size_t lowestCount = counter.count;
+	counter.chunk.assign(s, n);
+	counter.width = width;
+	counter.hash = probe.hash;
+	counter.count = lowestCount + occurrences;
+	counter.error = lowestCount + error;
+
+	slots[findEmptySlot(probe.hash)] = index + 1;
+	siftDown(0);
+}
+
+void ColumnSketch::insert(const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences, std::size_t error)
+{
+	Probe result = probe(s, n);
+	if(result.found)
+	{
+		addOccurrences(result, occurrences, error);
+	}
+	else
+	{
+		add(result, s, n, width, occurrences, error);
+	}
+}
+
+void ColumnSketch::merge(const ColumnSketch& other)
+{
+	for(std::size_t i = 0; i < registers.size(); ++i)
+	{
+		if(other.registers[i] > registers[i])
+		{
+			registers[i] = other.registers[i];
+		}
+	}
+
+	for(auto it = other.counters.cbegin(); it != other.counters.cend(); ++it)
+	{
+		insert(it -> chunk.data(), it -> chunk.size(), it -> width, it -> count, it -> error);
+	}
+}
+
+void ColumnSketch::serialize(StateWriter& writer) const
+{
+	writer.writeBytes(registers.data(), registers.size());
+	writer.writeInteger(counters.size());
+	for(auto it = counters.cbegin(); it != counters.cend(); ++it)
+	{
+		writer.writeString(it -> chunk.data(), it -> chunk.size());
+		writer.writeInteger(it -> width);
+		writer.writeInteger(it -> count);
+		writer.writeInteger(it -> error);
+	}
+}
+
+bool ColumnSketch::deserialize(StateReader& reader)
+{
+	const char* savedRegisters = reader.readBytes(registers.size());
+	std::size_t counterCount = reader.readInteger();
+	if(reader.hasFailed() || counterCount > capacity || counterCount > reader.remaining())
+	{
+		return false;
+	}
+
+	for(std::size_t i = 0; i < counterCount; ++i)
+	{
+		std::size_t length;
+		const std::uint8_t* chunk = (const std::uint8_t*) reader.readString(length);
+		int width = reader.readInteger();
+		std::size_t count = reader.readInteger();
+		std::size_t error = reader.readInteger();
+		if(reader.hasFailed())
+		{
+			return false;
+		}
+
+		Probe result = probe(chunk, length);
+		if(result.found)
+		{
+			// each chunk is only monitored once
+			return false;
+		}
+		add(result, chunk, length, width, count, error);
+	}
+
+	// adding the chunks counted them in the registers, which the saved registers already account for
+	std::memcpy(registers.data(), savedRegisters, registers.size());
+	return true;
+}
+
+double ColumnSketch::estimateUnique() const
+{
+	const double registerCount = registers.size();
+	double inverseSum = 0;
+	std::size_t emptyRegisters = 0;
+	for(auto it = registers.cbegin(); it != registers.cend(); ++it)
+	{
+		inverseSum += std::ldexp(1.0, -*it);
+		emptyRegisters += *it == 0;
+	}
+
+	double estimate = 0.7213 / (1 + 1.079 / registerCount) * registerCount * registerCount / inverseSum;
+	if(estimate <= 2.5 * registerCount && emptyRegisters != 0)
+	{
+		// few unique chunks have been counted, which linear counting estimates better
+		estimate = registerCount * std::log(registerCount / emptyRegisters);
+	}
+	return estimate;
+}
+
+void ColumnSketch::countUnique(std::uint64_t hash)
+{
+	// the top bits of the hash pick a register, which records the longest run of leading zeros in the rest of it
+	std::size_t index = hash >> (64 - REGISTER_BITS);
+	std::uint64_t rest = (hash << REGISTER_BITS) | (1ULL << (REGISTER_BITS - 1));
+	std::uint8_t rank = __builtin_clzll(rest) + 1;
+	if(rank > registers[index])
+	{
+		registers[index] = rank;
+	}
+}
+
+std::size_t ColumnSketch::findEmptySlot(std::uint64_t hash) const
+{
+	std::size_t position = hash & mask;
+	while(slots[position] != 0)
+	{
+		position = (position + 1) & mask;
+	}
+	return position;
+}
+
+void ColumnSketch::removeSlot(std::size_t index)
+{
+	std::size_t position = counters[index].hash & mask;
+	while(slots[position] != index + 1)
+	{
+		position = (position + 1) & mask;
+	}
+	slots[position] = 0;
+
+	// move back any later slot of the same run which would no longer be reachable from where its hash points to
+	for(std::size_t next = (position + 1) & mask; slots[next] != 0; next = (next + 1) & mask)
+	{
+		std::size_t home = counters[slots[next] - 1].hash & mask;
+		if(((next - home) & mask) >= ((next - position) & mask))
+		{
+			slots[position] = slots[next];
+			slots[next] = 0;
+			position = next;
+		}
+	}
+}
+
+void ColumnSketch::siftDown(std::size_t position)
+{
+	while(true)
+	{
+		std::size_t smallest = position;
+		std::size_t left = 2 * position + 1;
+		std::size_t right = left + 1;
+		if(left < heap.size() && counters[heap[left]].count < counters[heap[smallest]].count)
+		{
+			smallest = left;
+		}
+		if(right < heap.size() && counters[heap[right]].count < counters[heap[smallest]].count)
+		{
+			smallest = right;
+		}
+		if(smallest == position)
+		{
+			return;
+		}
+
+		std::swap(heap[position], heap[smallest]);
+		counters[heap[position]].heapPosition = position;
+		counters[heap[smallest]].heapPosition = smallest;
+		position = smallest;
+	}
+}
+
+void ColumnSketch::siftUp(std::size_t position)
+{
+	while(position > 0)
+	{
+		std::size_t parent = (position - 1) / 2;
+		if(counters[heap[parent]].count <= counters[heap[position]].count)
+		{
+			return;
+		}
+
+		std::swap(heap[position], heap[parent]);
+		counters[heap[position]].heapPosition = position;
+		counters[heap[parent]].heapPosition = parent;
+		position = parent;
+	}
+}
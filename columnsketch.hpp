@@ -0,0 +1,184 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "statefile.hpp"
+
+#ifndef COLUMNSKETCH_H
+#define COLUMNSKETCH_H
+
+/*
+ * A fixed-size summary of a column of the pattern which has too many unique chunks to keep them all. Estimates the
+ * number of unique chunks with a HyperLogLog counter, and keeps track of the most frequent chunks with the Space-Saving
+ * algorithm: a fixed number of chunks are monitored with a count each, and a chunk which is not monitored replaces the
+ * one with the lowest count, inheriting that count as its possible overestimate. Any chunk which makes up more than
+ * 1 / capacity of all occurrences is guaranteed to be monitored. Memory use depends only on the capacity, and on the
+ * lengths of the chunks monitored at any one time.
+ */
+class ColumnSketch
+{
+	public:
+		/*
+		 * A chunk monitored by the sketch.
+		 */
+		struct Counter
+		{
+			std::basic_string<std::uint8_t> chunk; /* the bytes of the chunk */
+			int width; /* the number of columns required to display the chunk on a terminal */
+			std::uint64_t hash; /* the hash of the chunk, as computed by ChunkColumn::hash */
+			std::size_t count; /* the number of occurrences of the chunk, possibly overestimated */
+			std::size_t error; /* the most by which count may be overestimated */
+			std::size_t heapPosition; /* the position of this counter in the sketch's heap */
+		};
+
+		/*
+		 * The result of looking up a chunk with ColumnSketch::probe.
+		 */
+		struct Probe
+		{
+			bool found; /* whether the chunk is monitored */
+			std::size_t position; /* the chunk's slot in the hash table, if found */
+			std::uint64_t hash; /* the hash of the chunk */
+		};
+
+		/*
+		 * Constructs an empty ColumnSketch object.
+		 * @param _capacity the number of chunks to monitor. Must be at least 1
+		 */
+		ColumnSketch(std::size_t _capacity);
+
+		/*
+		 * Looks a chunk up among the monitored chunks, without changing anything.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @return whether and where the chunk is monitored
+		 */
+		Probe probe(const std::uint8_t* s, std::size_t n) const;
+
+		/*
+		 * Counts more occurrences of a chunk which was found by ColumnSketch::probe.
+		 * @param probe the result of probing for the chunk
+		 * @param occurrences the number of times the chunk occurred again
+		 * @param error how much occurrences may be overestimated
+		 */
+		void addOccurrences(const Probe& probe, std::size_t occurrences = 1, std::size_t error = 0);
+
+		/*
+		 * Starts monitoring a chunk which was not found by ColumnSketch::probe, in place of the monitored chunk with
+		 * the lowest count if the sketch is full. The sketch must not have been changed since the chunk was probed for.
+		 * @param probe the result of probing for the chunk
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @param width the number of columns required to display the chunk on a terminal
+		 * @param occurrences the number of times the chunk occurred
+		 * @param error how much occurrences may be overestimated
+		 */
+		void add(const Probe& probe, const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences = 1,
+		         std::size_t error = 0);
+
+		/*
+		 * Adds occurrences of a chunk, whether it is monitored or not.
+		 * @param s the bytes of the chunk
+		 * @param n the number of bytes in the chunk
+		 * @param width the number of columns required to display the chunk on a terminal
+		 * @param occurrences the number of times the chunk occurred
+		 * @param error how much occurrences may be overestimated
+		 */
+		void insert(const std::uint8_t* s, std::size_t n, int width, std::size_t occurrences = 1, std::size_t error = 0);
+
+		/*
+		 * Adds everything counted by another sketch to this one, as if this sketch had counted it itself. The
+		 * HyperLogLog counters are merged exactly; the monitored chunks of other are added like any other occurrences.
+		 * @param other the sketch to merge into this one. Must have the same capacity
+		 */
+		void merge(const ColumnSketch& other);
+
+		/*
+		 * Writes out the HyperLogLog registers and the monitored chunks, so that they can be restored by
+		 * ColumnSketch::deserialize.
+		 * @param writer where to write the sketch to
+		 */
+		void serialize(StateWriter& writer) const;
+
+		/*
+		 * Restores a sketch written out by ColumnSketch::serialize into this sketch, which must be empty.
+		 * @param reader where to read the sketch from
+		 * @return true if the sketch was restored; false if it is malformed, or monitored more chunks than this sketch
+		 *         can, in which case this sketch is left in an unspecified state
+		 */
+		bool deserialize(StateReader& reader);
+
+		/*
+		 * @return the estimated number of unique chunks counted
+		 */
+		double estimateUnique() const;
+
+		/*
+		 * @return the monitored chunks, in no particular order
+		 */
+		const std::vector<Counter>& getCounters() const { return counters; }
+	private:
+		/* the number of bits of each hash used to pick a HyperLogLog register */
+		static const unsigned REGISTER_BITS = 12;
+
+		const std::size_t capacity; /* the number of chunks to monitor */
+		std::vector<Counter> counters; /* the monitored chunks */
+		std::vector<std::size_t> heap; /* indices into counters, as a min-heap ordered by count */
+		std::vector<std::uint32_t> slots; /* hash table of 1 + indices into counters. Zero marks an empty slot */
+		std::size_t mask; /* slots.size() - 1, used to wrap around the table */
+		std::vector<std::uint8_t> registers; /* the HyperLogLog registers */
+
+		/*
+		 * Records a hash in the HyperLogLog registers.
+		 * @param hash the hash of a chunk
+		 */
+		void countUnique(std::uint64_t hash);
+
+		/*
+		 * Finds the empty slot in the hash table where a hash would be added.
+		 * @param hash the hash of a chunk which is not monitored
+		 * @return the position of the slot
+		 */
+		std::size_t findEmptySlot(std::uint64_t hash) const;
+
+		/*
+		 * Removes a monitored chunk from the hash table, moving later slots back to close the gap.
+		 * @param index the index of the chunk in counters
+		 */
+		void removeSlot(std::size_t index);
+
+		/*
+		 * Moves a counter down the heap until its count is no greater than those of its children.
+		 * @param position the counter's position in heap
+		 */
+		void siftDown(std::size_t position);
+
+		/*
+		 * Moves a counter up the heap until its count is no less than that of its parent.
+		 * @param position the counter's position in heap
+		 */
+		void siftUp(std::size_t position);
+};
+
+#endif /* COLUMNSKETCH_H */
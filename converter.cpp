@@ -0,0 +1,149 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <uniconv.h>
+#include "converter.hpp"
+
+LocaleConverter::LocaleConverter(const char* _localeCode) :
+			localeCode(_localeCode),
+			toUtf8Descriptor((iconv_t) -1),
+			fromUtf8Descriptor((iconv_t) -1)
+{
+	// libunistring doesn't use iconv at all when the locale is utf-8 to begin with
+	if(std::strcmp(localeCode, "UTF-8") != 0)
+	{
+		toUtf8Descriptor = iconv_open("UTF-8", localeCode);
+		fromUtf8Descriptor = iconv_open(localeCode, "UTF-8");
+	}
+}
+
+LocaleConverter::~LocaleConverter()
+{
+	if(toUtf8Descriptor != (iconv_t) -1)
+	{
+		iconv_close(toUtf8Descriptor);
+	}
+	if(fromUtf8Descriptor != (iconv_t) -1)
+	{
+		iconv_close(fromUtf8Descriptor);
+	}
+}
+
+std::uint8_t* LocaleConverter::toUtf8(const char* src, std::size_t srclen, std::uint8_t* resultbuf, std::size_t* lengthp)
+{
+	if(toUtf8Descriptor != (iconv_t) -1)
+	{
+		std::size_t length = *lengthp;
+		char* result = convert(toUtf8Descriptor, src, srclen, (char*) resultbuf, &length);
+		if(result != nullptr)
+		{
+			*lengthp = length;
+			return (std::uint8_t*) result;
+		}
+	}
+
+	return u8_conv_from_encoding(localeCode, iconveh_question_mark, src, srclen, nullptr, resultbuf, lengthp);
+}
+
+char* LocaleConverter::fromUtf8(const std::uint8_t* src, std::size_t srclen, char* resultbuf, std::size_t* lengthp)
+{
+	if(fromUtf8Descriptor != (iconv_t) -1)
+	{
+		std::size_t length = *lengthp;
+		char* result = convert(fromUtf8Descriptor, (const char*) src, srclen, resultbuf, &length);
+		if(result != nullptr)
+		{
+			*lengthp = length;
+			return result;
+		}
+	}
+
+	return u8_conv_to_encoding(localeCode, iconveh_question_mark, src, srclen, nullptr, resultbuf, lengthp);
+}
+
+char* LocaleConverter::convert(iconv_t descriptor, const char* src, std::size_t srclen, char* resultbuf,
+                               std::size_t* lengthp)
+{
+	// return the descriptor to its initial shift state, in case an earlier conversion was abandoned partway
+	iconv(descriptor, nullptr, nullptr, nullptr, nullptr);
+
+	char* result = resultbuf;
+	std::size_t capacity = *lengthp;
+	std::size_t used = 0;
+	char* in = (char*) src;
+	std::size_t inLeft = srclen;
+	bool flushing = false;
+
+	while(true)
+	{
+		char* out = result + used;
+		std::size_t outLeft = capacity - used;
+
+		// convert the string, then write out whatever is needed to return to the initial shift state
+		std::size_t converted = flushing ? iconv(descriptor, nullptr, nullptr, &out, &outLeft)
+		                                 : iconv(descriptor, &in, &inLeft, &out, &outLeft);
+		used = out - result;
+
+		if(converted != (std::size_t) -1)
+		{
+			if(flushing)
+			{
+				break;
+			}
+			flushing = true;
+			continue;
+		}
+		if(errno != E2BIG)
+		{
+			// invalid or unconvertible input, which is left to libunistring's error handling
+			if(result != resultbuf)
+			{
+				std::free(result);
+			}
+			return nullptr;
+		}
+
+		// the result doesn't fit, so move it to a bigger buffer
+		std::size_t grownCapacity = 2 * capacity + srclen + 16;
+		char* grown = (char*) std::malloc(grownCapacity);
+		if(grown == nullptr)
+		{
+			if(result != resultbuf)
+			{
+				std::free(result);
+			}
+			return nullptr;
+		}
+		std::memcpy(grown, result, used);
+		if(result != resultbuf)
+		{
+			std::free(result);
+		}
+		result = grown;
+		capacity = grownCapacity;
+	}
+
+	*lengthp = used;
+	return result;
+}
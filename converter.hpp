@@ -0,0 +1,94 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <iconv.h>
+
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+/*
+ * Transcodes strings between the user's locale and utf-8, through iconv conversion descriptors which are opened once
+ * and kept for the lifetime of the object, instead of once per string as with libunistring's u8_conv_from_encoding and
+ * u8_conv_to_encoding. Otherwise behaves exactly like those two functions with the iconveh_question_mark handler, and
+ * follows the same buffer protocol, so it can be used with Summarizer::SmartBuffer and Summarizer::checkResult.
+ * A LocaleConverter must only be used by one thread at a time; each Summarizer has its own.
+ */
+class LocaleConverter
+{
+	public:
+		/*
+		 * Constructs a LocaleConverter object, opening its conversion descriptors. If the user's locale already uses
+		 * utf-8, or iconv doesn't know the locale's encoding, the libunistring functions are used instead.
+		 * @param _localeCode libunistring-recognized code for the user's locale
+		 */
+		LocaleConverter(const char* _localeCode);
+
+		/*
+		 * Closes the conversion descriptors.
+		 */
+		~LocaleConverter();
+
+		LocaleConverter(const LocaleConverter&) = delete;
+		LocaleConverter& operator=(const LocaleConverter&) = delete;
+
+		/*
+		 * Transcodes a string from the user's locale into utf-8, like u8_conv_from_encoding.
+		 * @param src the string to transcode
+		 * @param srclen the number of bytes in src
+		 * @param resultbuf buffer to write the result to, if it is big enough
+		 * @param lengthp in: the size of resultbuf. out: the number of bytes in the result
+		 * @return resultbuf if the result fit in it; otherwise a newly allocated buffer holding the result, or NULL if
+		 *         there was an error, with errno set
+		 */
+		std::uint8_t* toUtf8(const char* src, std::size_t srclen, std::uint8_t* resultbuf, std::size_t* lengthp);
+
+		/*
+		 * Transcodes a string from utf-8 into the user's locale, like u8_conv_to_encoding.
+		 * @param src the string to transcode
+		 * @param srclen the number of bytes in src
+		 * @param resultbuf buffer to write the result to, if it is big enough
+		 * @param lengthp in: the size of resultbuf. out: the number of bytes in the result
+		 * @return resultbuf if the result fit in it; otherwise a newly allocated buffer holding the result, or NULL if
+		 *         there was an error, with errno set
+		 */
+		char* fromUtf8(const std::uint8_t* src, std::size_t srclen, char* resultbuf, std::size_t* lengthp);
+	private:
+		const char* localeCode; /* libunistring-recognized code for the user's locale */
+		iconv_t toUtf8Descriptor; /* converts from the user's locale to utf-8, or (iconv_t) -1 if not in use */
+		iconv_t fromUtf8Descriptor; /* converts from utf-8 to the user's locale, or (iconv_t) -1 if not in use */
+
+		/*
+		 * Transcodes a string with a conversion descriptor, following the buffer protocol of LocaleConverter::toUtf8.
+		 * @param descriptor the conversion descriptor to use
+		 * @param src the string to transcode
+		 * @param srclen the number of bytes in src
+		 * @param resultbuf buffer to write the result to, if it is big enough
+		 * @param lengthp in: the size of resultbuf. out: the number of bytes in the result
+		 * @return resultbuf, a newly allocated buffer, or NULL if src could not be transcoded as it is (e.g. it has
+		 *         invalid or unconvertible characters, which libunistring then handles)
+		 */
+		static char* convert(iconv_t descriptor, const char* src, std::size_t srclen, char* resultbuf,
+		                     std::size_t* lengthp);
+};
+
+#endif /* CONVERTER_H */
@@ -0,0 +1,322 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "dirwalker.hpp"
+
+#ifdef __linux__
+/* the layout of the records written by the getdents64 system call, which has no wrapper in older C libraries */
+struct LinuxDirent64
+{
+	std::uint64_t d_ino;
+	std::int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+#endif
+
+DirectoryWalker::DirectoryWalker(IngestPool& _pool, bool _recursive, bool _relativePaths, unsigned _threadCount) :
+			pool(_pool),
+			recursive(_recursive),
+			relativePaths(_relativePaths),
+			threadCount(_recursive ? _threadCount : 1),
+			listing(false),
+			rootPath(nullptr),
+			rootDescriptor(-1),
+			pendingDirectories(0),
+			queuedDirectories(0)
+{}
+
+void DirectoryWalker::walk(const char* root)
+{
+	rootPath = root;
+	rootDescriptor = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(rootDescriptor < 0)
+	{
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+
+	queues.clear();
+	for(unsigned i = 0; i < threadCount; ++i)
+	{
+		queues.emplace_back(new WorkQueue);
+	}
+
+	// the root directory is represented by an empty relative path
+	queues.front() -> directories.emplace_back();
+	pendingDirectories = 1;
+	queuedDirectories = 1;
+
+	if(threadCount == 1)
+	{
+		work(0);
+	}
+	else
+	{
+		std::vector<std::thread> walkers;
+		for(unsigned i = 0; i < threadCount; ++i)
+		{
+			walkers.emplace_back(&DirectoryWalker::work, this, i);
+		}
+		for(auto it = walkers.begin(); it != walkers.end(); ++it)
+		{
+			it -> join();
+		}
+	}
+
+	close(rootDescriptor);
+}
+
+void DirectoryWalker::listNames(const char* root, std::vector<std::string>& names)
+{
+	listedNames.assign(threadCount, std::vector<std::string>());
+	listing = true;
+	walk(root);
+	listing = false;
+
+	names.clear();
+	for(auto it = listedNames.begin(); it != listedNames.end(); ++it)
+	{
+		names.insert(names.end(), std::make_move_iterator(it -> begin()), std::make_move_iterator(it -> end()));
+	}
+	listedNames.clear();
+}
+
+void DirectoryWalker::work(std::size_t index)
+{
+	BlockWriter writer(pool);
+	std::vector<char> buffer(ENTRY_BUFFER_SIZE);
+	std::string directory;
+	Stats threadStats;
+
+	while(true)
+	{
+		if(takeDirectory(index, directory))
+		{
+			// once the pool's time budget runs out, the directories still queued up are skipped
+			if(!pool.isExpired() && !readDirectory(directory, index, writer, buffer.data(), threadStats))
+			{
+				if(directory.empty())
+				{
+					std::perror(nullptr);
+					std::exit(EXIT_FAILURE);
+				}
+
+				// an unreadable subdirectory doesn't stop the rest of the walk
+				std::fprintf(stderr, "%s/%.*s: %s\n", rootPath, (int) directory.size() - 1, directory.data(),
+				             std::strerror(errno));
+			}
+
+			if(--pendingDirectories == 0)
+			{
+				// that was the last directory, so wake up every idle thread to let them exit
+				std::lock_guard<std::mutex> lock(idleMutex);
+				directoryQueued.notify_all();
+			}
+			continue;
+		}
+
+		// every queue is empty, but other threads may still queue up subdirectories of what they are reading
+		std::unique_lock<std::mutex> lock(idleMutex);
+		directoryQueued.wait(lock, [this]() { return pendingDirectories == 0 || queuedDirectories > 0; });
+		if(pendingDirectories == 0)
+		{
+			stats.merge(threadStats);
+			return;
+		}
+	}
+}
+
+bool DirectoryWalker::takeDirectory(std::size_t index, std::string& directory)
+{
+	for(std::size_t i = 0; i < queues.size(); ++i)
+	{
+		WorkQueue& queue = *queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.directories.empty())
+		{
+			if(i == 0)
+			{
+				directory.swap(queue.directories.back());
+				queue.directories.pop_back();
+			}
+			else
+			{
+				directory.swap(queue.directories.front());
+				queue.directories.pop_front();
+			}
+			--queuedDirectories;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool DirectoryWalker::readDirectory(const std::string& directory, std::size_t index, BlockWriter& writer, char* buffer,
+                                    Stats& threadStats)
+{
+	threadStats.count(Stats::DIRECTORIES);
+	int directoryDescriptor = openat(rootDescriptor, directory.empty() ? "." : directory.c_str(),
+	                                 O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+	if(directoryDescriptor < 0)
+	{
+		return false;
+	}
+
+	std::string path(directory);
+#ifdef __linux__
+	// read as many entries at once as will fit in the buffer
+	while(true)
+	{
+		long bytesRead;
+		{
+			StageTimer timer(threadStats, Stats::READ_DIRECTORY);
+			bytesRead = syscall(SYS_getdents64, directoryDescriptor, buffer, ENTRY_BUFFER_SIZE);
+		}
+		if(bytesRead < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			int readError = errno;
+			close(directoryDescriptor);
+			errno = readError;
+			return false;
+		}
+		if(bytesRead == 0)
+		{
+			break;
+		}
+
+		for(long offset = 0; offset < bytesRead;)
+		{
+			const LinuxDirent64* entry = (const LinuxDirent64*) (buffer + offset);
+			offset += entry -> d_reclen;
+
+			int isDirectory = entry -> d_type == DT_UNKNOWN ? -1 : entry -> d_type == DT_DIR;
+			handleEntry(directoryDescriptor, path, directory.size(), entry -> d_name, isDirectory, index, writer);
+		}
+		if(pool.isExpired())
+		{
+			break;
+		}
+	}
+	close(directoryDescriptor);
+#else
+	(void) buffer;
+	DIR* dir = fdopendir(directoryDescriptor);
+	if(dir == nullptr)
+	{
+		int openError = errno;
+		close(directoryDescriptor);
+		errno = openError;
+		return false;
+	}
+
+	dirent* ent;
+	while(true)
+	{
+		{
+			StageTimer timer(threadStats, Stats::READ_DIRECTORY);
+			ent = readdir(dir);
+		}
+		if(ent == nullptr || pool.isExpired())
+		{
+			break;
+		}
+
+		handleEntry(directoryDescriptor, path, directory.size(), ent -> d_name, -1, index, writer);
+	}
+	closedir(dir);
+#endif
+
+	return true;
+}
+
+void DirectoryWalker::handleEntry(int directoryDescriptor, std::string& path, std::size_t directoryLength,
+                                  const char* name, int isDirectory, std::size_t index, BlockWriter& writer)
+{
+	if(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+	{
+		// ignore the "." and ".." in the directory
+		return;
+	}
+
+	std::size_t nameLength = std::strlen(name);
+	path.resize(directoryLength);
+	path.append(name, nameLength);
+	if(listing)
+	{
+		listedNames[index].emplace_back(relativePaths ? path.data() : name, relativePaths ? path.size() : nameLength);
+	}
+	else if(relativePaths)
+	{
+		writer.inputFilename(path.data(), path.size());
+	}
+	else
+	{
+		writer.inputFilename(name, nameLength);
+	}
+
+	if(!recursive)
+	{
+		return;
+	}
+
+	if(isDirectory < 0)
+	{
+		// the filesystem didn't say what type of entry this is, so ask it explicitly
+		struct stat status;
+		isDirectory = fstatat(directoryDescriptor, name, &status, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(status.st_mode);
+	}
+
+	if(isDirectory)
+	{
+		path.push_back('/');
+		{
+			WorkQueue& queue = *queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.directories.push_back(path);
+			++pendingDirectories;
+			++queuedDirectories;
+		}
+
+		std::lock_guard<std::mutex> lock(idleMutex);
+		directoryQueued.notify_one();
+	}
+}
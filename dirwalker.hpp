@@ -0,0 +1,155 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ingestpool.hpp"
+#include "stats.hpp"
+
+#ifndef DIRWALKER_H
+#define DIRWALKER_H
+
+/*
+ * Lists the entries of a directory, and optionally of all its subdirectories, and submits their names to an
+ * IngestPool. Entries are read from each directory in large batches (with getdents64 where it is available), so that
+ * a slow filesystem is asked for entries as few times as possible. Subdirectories are shared out between several
+ * walker threads by work stealing: each thread works through its own queue of directories, and takes directories from
+ * the queues of other threads once it runs out. Since the names are ingested by the IngestPool's own threads, reading
+ * directories overlaps with the Unicode processing of the names read so far.
+ */
+class DirectoryWalker
+{
+	public:
+		/*
+		 * Constructs a DirectoryWalker object.
+		 * @param _pool the IngestPool to submit names to
+		 * @param _recursive whether to descend into subdirectories
+		 * @param _relativePaths whether to submit each entry's path relative to the root directory, instead of just
+		 *        its name
+		 * @param _threadCount the number of walker threads to use when _recursive is true. Must be at least 1
+		 */
+		DirectoryWalker(IngestPool& _pool, bool _recursive, bool _relativePaths, unsigned _threadCount);
+
+		/*
+		 * Submits the names of all entries under the root directory to the IngestPool, and returns once they have
+		 * all been submitted, or as soon as the IngestPool's time budget runs out. The "." and ".." entries are
+		 * skipped, and symbolic links are not followed.
+		 * Subdirectories which cannot be read are reported on stderr and skipped.
+		 * Halts program if the root directory cannot be read.
+		 * @param root the directory to list
+		 */
+		void walk(const char* root);
+
+		/*
+		 * Same as DirectoryWalker::walk, but collects the names which would have been submitted to the IngestPool,
+		 * instead of submitting them.
+		 * @param root the directory to list
+		 * @param names set to the names of all entries under the root directory, in no particular order
+		 */
+		void listNames(const char* root, std::vector<std::string>& names);
+
+		/*
+		 * @return the time spent reading directories, and the number of directories read, over all walks so far
+		 */
+		const Stats& getStats() const { return stats; }
+	private:
+		/* the size of the buffer each walker thread reads directory entries into */
+		static const std::size_t ENTRY_BUFFER_SIZE = 1 << 17;
+
+		/*
+		 * A walker thread's queue of directories waiting to be read. The owner takes directories from the back, so
+		 * that it finishes subtrees it has started on; other threads steal from the front, where the directories
+		 * closest to the root, and so likely to have the biggest subtrees, are.
+		 */
+		struct WorkQueue
+		{
+			std::mutex mutex; /* guards directories */
+			std::deque<std::string> directories; /* paths relative to the root directory, each ending in '/' */
+		};
+
+		IngestPool& pool; /* the pool which names are submitted to */
+		const bool recursive; /* whether subdirectories are descended into */
+		const bool relativePaths; /* whether paths relative to the root are submitted instead of names */
+		const unsigned threadCount; /* the number of walker threads used when recursive */
+		bool listing; /* whether names are being collected by DirectoryWalker::listNames, instead of submitted */
+		std::vector<std::vector<std::string>> listedNames; /* the names collected by each walker thread while listing */
+
+		const char* rootPath; /* the directory being walked */
+		int rootDescriptor; /* open file descriptor for rootPath, which subdirectories are opened relative to */
+		std::vector<std::unique_ptr<WorkQueue>> queues; /* one queue per walker thread */
+		std::atomic<std::size_t> pendingDirectories; /* directories queued up or being read, over all queues */
+		std::atomic<std::size_t> queuedDirectories; /* directories queued up, over all queues */
+		std::mutex idleMutex; /* used alongside directoryQueued */
+		std::condition_variable directoryQueued; /* signalled when a directory is queued, or the walk is over */
+		Stats stats; /* the stats of every walker thread which has finished, guarded by idleMutex */
+
+		/*
+		 * The body of each walker thread: reads directories from its own queue, or stolen from other queues, until
+		 * every directory has been read.
+		 * @param index the index of this thread's queue in queues
+		 */
+		void work(std::size_t index);
+
+		/*
+		 * Takes the next directory to read, from this thread's own queue if possible, or else from another's.
+		 * @param index the index of this thread's queue in queues
+		 * @param directory set to the path of the directory taken
+		 * @return true if a directory was taken; false if every queue was empty
+		 */
+		bool takeDirectory(std::size_t index, std::string& directory);
+
+		/*
+		 * Reads every entry of a directory, submitting their names through writer, and queueing up any
+		 * subdirectories on this thread's queue if walking recursively.
+		 * @param directory the path of the directory relative to the root: empty for the root itself, and otherwise
+		 *        ending in '/'
+		 * @param index the index of this thread's queue in queues
+		 * @param writer where to submit the names of the entries to
+		 * @param buffer scratch space of ENTRY_BUFFER_SIZE bytes to read entries into
+		 * @param threadStats where to add the time spent reading the directory to
+		 * @return true if the directory could be read; false otherwise, with errno set
+		 */
+		bool readDirectory(const std::string& directory, std::size_t index, BlockWriter& writer, char* buffer,
+		                   Stats& threadStats);
+
+		/*
+		 * Handles a single entry of a directory being read by DirectoryWalker::readDirectory.
+		 * @param directoryDescriptor open file descriptor of the directory containing the entry
+		 * @param path scratch string starting with the path of that directory relative to the root, as for
+		 *        DirectoryWalker::readDirectory. Anything past directoryLength is overwritten
+		 * @param directoryLength the length of the directory's path at the start of path
+		 * @param name the NUL-terminated name of the entry
+		 * @param isDirectory 1 if the entry is known to be a directory, 0 if it is known not to be one, and -1 if
+		 *        unknown
+		 * @param index the index of this thread's queue in queues
+		 * @param writer where to submit the name of the entry to, unless it is being listed
+		 */
+		void handleEntry(int directoryDescriptor, std::string& path, std::size_t directoryLength, const char* name,
+		                 int isDirectory, std::size_t index, BlockWriter& writer);
+};
+
+#endif /* DIRWALKER_H */
@@ -0,0 +1,252 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "dirwatcher.hpp"
+#include "dirwalker.hpp"
+
+DirectoryWatcher::DirectoryWatcher(const char* _delimiters, const Summarizer::Options& _options,
+                                   const Summarizer::Layout& _layout, unsigned _threadCount) :
+			delimiters(_delimiters),
+			options(_options),
+			layout(_layout),
+			threadCount(_threadCount)
+{}
+
+void DirectoryWatcher::watch(const char* directory)
+{
+	// start watching before listing the directory, so that no change is missed. Changes which the listing already
+	// includes are recognized as such, since names are only ingested or removed when they appear or disappear
+	int inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotifyDescriptor < 0 ||
+	   inotify_add_watch(inotifyDescriptor, directory, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+	                                                   IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0)
+	{
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+
+	IngestPool pool(delimiters, threadCount, options);
+	DirectoryWalker walker(pool, false, false, threadCount);
+	std::vector<std::string> listedNames;
+	walker.listNames(directory, listedNames);
+	{
+		BlockWriter writer(pool);
+		for(auto it = listedNames.begin(); it != listedNames.end(); ++it)
+		{
+			writer.inputFilename(it -> data(), it -> size());
+			names.insert(std::move(*it));
+		}
+	}
+	std::vector<std::string>().swap(listedNames);
+
+	Summarizer& summarizer = pool.finish();
+	summarizer.setLayout(layout);
+	std::vector<char> frame;
+	redraw(summarizer, frame);
+	long long nextRedraw = now() + REDRAW_INTERVAL;
+
+	std::vector<char> buffer(EVENT_BUFFER_SIZE);
+	while(true)
+	{
+		// sleep until there are events, or until changes which came in too soon after the last redraw are due
+		int timeout = -1;
+		if(!pendingNames.empty())
+		{
+			long long wait = nextRedraw - now();
+			timeout = wait > 0 ? (int) ((wait + 999999) / 1000000) : 0;
+		}
+
+		pollfd descriptor;
+		descriptor.fd = inotifyDescriptor;
+		descriptor.events = POLLIN;
+		int ready = poll(&descriptor, 1, timeout);
+		if(ready < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			std::perror(nullptr);
+			std::exit(EXIT_FAILURE);
+		}
+		if(ready > 0 && !readEvents(inotifyDescriptor, directory, pool, buffer.data()))
+		{
+			break;
+		}
+
+		if(!pendingNames.empty() && now() >= nextRedraw && applyPendingNames(summarizer))
+		{
+			redraw(summarizer, frame);
+			nextRedraw = now() + REDRAW_INTERVAL;
+		}
+	}
+
+	close(inotifyDescriptor);
+}
+
+bool DirectoryWatcher::readEvents(int inotifyDescriptor, const char* directory, IngestPool& pool, char* buffer)
+{
+	while(true)
+	{
+		ssize_t bytesRead = read(inotifyDescriptor, buffer, EVENT_BUFFER_SIZE);
+		if(bytesRead < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				return true;
+			}
+			std::perror(nullptr);
+			std::exit(EXIT_FAILURE);
+		}
+
+		for(ssize_t offset = 0; offset < bytesRead;)
+		{
+			inotify_event event;
+			std::memcpy(&event, buffer + offset, sizeof(event));
+			const char* name = buffer + offset + sizeof(event);
+			offset += sizeof(event) + event.len;
+
+			if(event.mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+			{
+				return false;
+			}
+			if(event.mask & IN_Q_OVERFLOW)
+			{
+				// events were dropped, so there is no telling what changed without looking
+				rescan(directory, pool);
+				continue;
+			}
+			if(event.len == 0)
+			{
+				continue;
+			}
+
+			// the last event for a name since the last redraw decides whether it exists
+			std::string entry(name, strnlen(name, event.len));
+			if(event.mask & (IN_CREATE | IN_MOVED_TO))
+			{
+				pendingNames[entry] = true;
+			}
+			else if(event.mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				pendingNames[entry] = false;
+			}
+		}
+	}
+}
+
+void DirectoryWatcher::rescan(const char* directory, IngestPool& pool)
+{
+	DirectoryWalker walker(pool, false, false, threadCount);
+	std::vector<std::string> listedNames;
+	walker.listNames(directory, listedNames);
+
+	std::unordered_set<std::string> listed(listedNames.begin(), listedNames.end());
+	for(auto it = names.cbegin(); it != names.cend(); ++it)
+	{
+		if(listed.count(*it) == 0)
+		{
+			pendingNames[*it] = false;
+		}
+	}
+	for(auto it = listed.cbegin(); it != listed.cend(); ++it)
+	{
+		pendingNames[*it] = true;
+	}
+}
+
+bool DirectoryWatcher::applyPendingNames(Summarizer& summarizer)
+{
+	bool changed = false;
+	for(auto it = pendingNames.cbegin(); it != pendingNames.cend(); ++it)
+	{
+		auto existing = names.find(it -> first);
+		if(it -> second && existing == names.end())
+		{
+			summarizer.inputFilename(it -> first.data(), it -> first.size());
+			names.insert(it -> first);
+			changed = true;
+		}
+		else if(!it -> second && existing != names.end())
+		{
+			summarizer.removeFilename(it -> first.data(), it -> first.size());
+			names.erase(existing);
+			changed = true;
+		}
+	}
+	pendingNames.clear();
+	return changed;
+}
+
+void DirectoryWatcher::redraw(Summarizer& summarizer, std::vector<char>& frame)
+{
+	std::vector<char> summary;
+	int error = summarizer.renderSummary(summary);
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+
+	// go back to the top left corner, clear the rest of each line as it is drawn over, and then clear whatever is
+	// left below the new summary, so that nothing flickers
+	const char HOME[] = "\x1b[H";
+	const char CLEAR_LINE[] = "\x1b[K";
+	const char CLEAR_BELOW[] = "\x1b[J";
+	frame.assign(HOME, HOME + sizeof(HOME) - 1);
+	for(auto it = summary.cbegin(); it != summary.cend(); ++it)
+	{
+		if(*it == '\n')
+		{
+			frame.insert(frame.end(), CLEAR_LINE, CLEAR_LINE + sizeof(CLEAR_LINE) - 1);
+		}
+		frame.push_back(*it);
+	}
+	frame.insert(frame.end(), CLEAR_BELOW, CLEAR_BELOW + sizeof(CLEAR_BELOW) - 1);
+
+	error = Summarizer::writeFully(STDOUT_FILENO, frame.data(), frame.size());
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+long long DirectoryWatcher::now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
@@ -0,0 +1,116 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "summarizer.hpp"
+#include "ingestpool.hpp"
+
+#ifndef DIRWATCHER_H
+#define DIRWATCHER_H
+
+/*
+ * Keeps the pattern of a directory's entries on screen while entries are created, renamed and deleted, using inotify.
+ * The directory is only listed once: after that, each entry that appears is ingested into the pattern, and each entry
+ * that disappears is removed from it. Events are coalesced, so that e.g. a file which is created and deleted again
+ * before the next redraw costs nothing, and the screen is redrawn at most every REDRAW_INTERVAL, in place. Only the
+ * columns of the pattern which changed are sorted and encoded again for each redraw.
+ */
+class DirectoryWatcher
+{
+	public:
+		/*
+		 * Constructs a DirectoryWatcher object.
+		 * @param _delimiters passed on to the constructor of every Summarizer
+		 * @param _options passed on to the constructor of every Summarizer. Must not set a maximum number of unique
+		 *        substrings, since sketched columns cannot forget removed entries
+		 * @param _layout how to lay out the pattern on screen
+		 * @param _threadCount the number of threads to ingest the directory's entries on at first. Must be at least 1
+		 */
+		DirectoryWatcher(const char* _delimiters, const Summarizer::Options& _options,
+		                 const Summarizer::Layout& _layout, unsigned _threadCount);
+
+		/*
+		 * Prints the pattern of the entries in a directory, then keeps redrawing it as the entries change, until the
+		 * directory itself is deleted or moved.
+		 * Halts program if the directory cannot be read or watched.
+		 * @param directory the directory to watch
+		 */
+		void watch(const char* directory);
+	private:
+		/* the shortest time between two redraws, in nanoseconds */
+		static const long long REDRAW_INTERVAL = 100000000LL;
+
+		/* the size of the buffer that inotify events are read into */
+		static const std::size_t EVENT_BUFFER_SIZE = 1 << 16;
+
+		const char* delimiters; /* the delimiters passed to every Summarizer */
+		const Summarizer::Options options; /* the options passed to every Summarizer */
+		const Summarizer::Layout layout; /* how to lay out the pattern on screen */
+		const unsigned threadCount; /* the number of threads to ingest the directory's entries on at first */
+
+		std::unordered_set<std::string> names; /* the names of the entries in the pattern */
+
+		/* names which were created or deleted since the last redraw, each mapped to whether it exists now */
+		std::unordered_map<std::string, bool> pendingNames;
+
+		/*
+		 * Reads every inotify event that is waiting, and records the names they concern in pendingNames.
+		 * @param inotifyDescriptor the non-blocking inotify instance to read from
+		 * @param directory the directory being watched
+		 * @param pool the pool that the pattern was computed with
+		 * @param buffer scratch space of EVENT_BUFFER_SIZE bytes to read events into
+		 * @return false if the directory is no longer being watched; true otherwise
+		 */
+		bool readEvents(int inotifyDescriptor, const char* directory, IngestPool& pool, char* buffer);
+
+		/*
+		 * Lists the directory again, after inotify has dropped events, and records every difference with the names
+		 * in the pattern in pendingNames.
+		 * @param directory the directory being watched
+		 * @param pool the pool that the pattern was computed with
+		 */
+		void rescan(const char* directory, IngestPool& pool);
+
+		/*
+		 * Ingests or removes every name in pendingNames whose existence changed, and empties pendingNames.
+		 * @param summarizer holds the pattern
+		 * @return whether the pattern changed
+		 */
+		bool applyPendingNames(Summarizer& summarizer);
+
+		/*
+		 * Draws the pattern over whatever was drawn last, from the top left corner of the terminal.
+		 * @param summarizer holds the pattern
+		 * @param frame scratch buffer to render into
+		 */
+		static void redraw(Summarizer& summarizer, std::vector<char>& frame);
+
+		/*
+		 * @return the time on a clock which only moves forwards, in nanoseconds
+		 */
+		static long long now();
+};
+
+#endif /* DIRWATCHER_H */
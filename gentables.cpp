@@ -0,0 +1,304 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unigbrk.h>
+#include <unictype.h>
+#include <uninorm.h>
+#include <uniwidth.h>
+#include "segmenter.hpp"
+
+/*
+ * Generates the tables of code point properties which segmentGraphemes and isQuickNfc look code points up in, and
+ * prints them to standard output as a C++ header. The properties are taken from libunistring itself, so that the
+ * built-in segmenter and quick check agree with the libunistring they are built against. The tables are two-level:
+ * e.g. UNICODE_BLOCKS maps each block of 2^UNICODE_BLOCK_SHIFT code points to its properties in UNICODE_PROPERTIES,
+ * where identical blocks are only stored once. The block size which makes the tables smallest is chosen.
+ * GRAPHEME_BREAK_RULES holds the boundary rules of https://unicode.org/reports/tr29/#Grapheme_Cluster_Boundary_Rules ,
+ * which libunistring follows, for every pair of grapheme cluster break properties.
+ */
+
+const std::uint32_t CODE_POINTS = 0x110000;
+
+/*
+ * @param c a code point
+ * @return the properties of c, as laid out by CodePointProperty
+ */
+std::uint8_t properties(std::uint32_t c)
+{
+	int breakProperty = uc_graphemeclusterbreak_property(c);
+	if(breakProperty < 0 || breakProperty > GRAPHEME_BREAK_MASK)
+	{
+		std::fprintf(stderr, "U+%04X has the unexpected grapheme cluster break property %d\n", c, breakProperty);
+		std::exit(EXIT_FAILURE);
+	}
+
+	int width = uc_width(c, "UTF-8");
+	int cjkWidth = uc_width(c, "EUC-JP");
+	if(width > 2 || (cjkWidth != width && (width != 1 || cjkWidth != 2)))
+	{
+		std::fprintf(stderr, "U+%04X has the unexpected widths %d and %d\n", c, width, cjkWidth);
+		std::exit(EXIT_FAILURE);
+	}
+
+	std::uint8_t result = breakProperty;
+	result |= uc_is_property_extended_pictographic(c) ? EXTENDED_PICTOGRAPHIC_BIT : 0;
+	result |= (width < 0 ? CONTROL_WIDTH : width) << WIDTH_SHIFT;
+	result |= cjkWidth != width ? CJK_WIDE_BIT : 0;
+	return result;
+}
+
+/*
+ * @param c a code point, other than a surrogate
+ * @param utf8 out: the utf-8 encoding of c
+ * @return the number of bytes written to utf8
+ */
+std::size_t encodeUtf8(std::uint32_t c, std::uint8_t* utf8)
+{
+	if(c < 0x80)
+	{
+		utf8[0] = c;
+		return 1;
+	}
+	std::size_t length = c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+	for(std::size_t i = length - 1; i > 0; --i, c >>= 6)
+	{
+		utf8[i] = 0x80 | (c & 0x3F);
+	}
+	utf8[0] = (0xF00 >> length) | c;
+	return length;
+}
+
+/*
+ * Works out the NFC_Quick_Check property of every code point, which libunistring does not provide, from the
+ * normalization data it does: a code point is "No" if normalizing it by itself changes it, and "Maybe" if it is the
+ * second of the two code points which a composite one, that is not itself "No", decomposes into.
+ * @return for each code point, its canonical combining class if it is "Yes", or else NFC_NOT_QUICK
+ */
+std::vector<std::uint8_t> nfcClasses()
+{
+	std::vector<std::uint8_t> classes(CODE_POINTS);
+	for(std::uint32_t c = 0; c < CODE_POINTS; ++c)
+	{
+		int combiningClass = uc_combining_class(c);
+		if(combiningClass < 0 || combiningClass >= NFC_NOT_QUICK)
+		{
+			std::fprintf(stderr, "U+%04X has the unexpected canonical combining class %d\n", c, combiningClass);
+			std::exit(EXIT_FAILURE);
+		}
+		classes[c] = combiningClass;
+	}
+
+	for(std::uint32_t c = 0; c < CODE_POINTS; ++c)
+	{
+		if(c >= 0xD800 && c < 0xE000)
+		{
+			// surrogates cannot be encoded in utf-8 at all
+			classes[c] = NFC_NOT_QUICK;
+			continue;
+		}
+		std::uint8_t utf8[4];
+		std::size_t length = encodeUtf8(c, utf8);
+
+		std::uint8_t normalized[32];
+		std::size_t normalizedLength = sizeof(normalized);
+		std::uint8_t* result = u8_normalize(UNINORM_NFC, utf8, length, normalized, &normalizedLength);
+		if(result == nullptr)
+		{
+			std::perror(nullptr);
+			std::exit(EXIT_FAILURE);
+		}
+		bool unchanged = normalizedLength == length && std::memcmp(result, utf8, length) == 0;
+		if(result != normalized)
+		{
+			std::free(result);
+		}
+		if(!unchanged)
+		{
+			classes[c] = NFC_NOT_QUICK;
+			continue;
+		}
+
+		std::uint32_t decomposition[UC_DECOMPOSITION_MAX_LENGTH];
+		if(uc_canonical_decomposition(c, decomposition) == 2)
+		{
+			classes[decomposition[1]] = NFC_NOT_QUICK;
+		}
+	}
+	return classes;
+}
+
+/*
+ * @param previous the grapheme cluster break property of the code point before a boundary
+ * @param next the grapheme cluster break property of the code point after the boundary
+ * @return whether there is a grapheme cluster boundary between the code points
+ */
+GraphemeBreakRule rule(int previous, int next)
+{
+	if(previous == GBP_CR && next == GBP_LF)
+	{
+		return NO_BREAK; // GB3
+	}
+	if(previous == GBP_CONTROL || previous == GBP_CR || previous == GBP_LF ||
+	   next == GBP_CONTROL || next == GBP_CR || next == GBP_LF)
+	{
+		return BREAK; // GB4, GB5
+	}
+	if(previous == GBP_L && (next == GBP_L || next == GBP_V || next == GBP_LV || next == GBP_LVT))
+	{
+		return NO_BREAK; // GB6
+	}
+	if((previous == GBP_LV || previous == GBP_V) && (next == GBP_V || next == GBP_T))
+	{
+		return NO_BREAK; // GB7
+	}
+	if((previous == GBP_LVT || previous == GBP_T) && next == GBP_T)
+	{
+		return NO_BREAK; // GB8
+	}
+	if(next == GBP_EXTEND || next == GBP_ZWJ || next == GBP_SPACINGMARK || previous == GBP_PREPEND)
+	{
+		return NO_BREAK; // GB9, GB9a, GB9b
+	}
+	if(previous == GBP_ZWJ)
+	{
+		return BREAK_UNLESS_EMOJI; // GB11
+	}
+	if(previous == GBP_RI && next == GBP_RI)
+	{
+		return BREAK_UNLESS_ODD_REGIONAL; // GB12, GB13
+	}
+	return BREAK; // GB999
+}
+
+/* a two-level table */
+struct Tables
+{
+	unsigned shift; /* each block holds 2^shift code points */
+	std::vector<std::uint16_t> blocks; /* the index of each block in values, in units of blocks */
+	std::vector<std::uint8_t> values; /* the values of the code points of every distinct block */
+};
+
+/*
+ * Splits a value of every code point into blocks, and stores each distinct one once.
+ * @param all the value of every code point
+ * @param shift each block holds 2^shift code points
+ * @return the tables
+ */
+Tables buildTables(const std::vector<std::uint8_t>& all, unsigned shift)
+{
+	Tables tables;
+	tables.shift = shift;
+	std::size_t blockSize = (std::size_t) 1 << shift;
+	for(std::size_t start = 0; start < all.size(); start += blockSize)
+	{
+		// blocks are few enough that searching through them is fast enough for a build step
+		std::size_t index = 0;
+		std::size_t blockCount = tables.values.size() / blockSize;
+		while(index < blockCount &&
+		      std::memcmp(tables.values.data() + index * blockSize, all.data() + start, blockSize) != 0)
+		{
+			++index;
+		}
+		if(index == blockCount)
+		{
+			tables.values.insert(tables.values.end(), all.begin() + start, all.begin() + start + blockSize);
+		}
+		tables.blocks.push_back(index);
+	}
+	return tables;
+}
+
+template <typename T> void printArray(const char* declaration, const std::vector<T>& values)
+{
+	std::printf("constexpr %s[] = {", declaration);
+	for(std::size_t i = 0; i < values.size(); ++i)
+	{
+		std::printf("%s%u", i == 0 ? "\n\t" : i % 16 == 0 ? ",\n\t" : ", ", (unsigned) values[i]);
+	}
+	std::printf("\n};\n\n");
+}
+
+/*
+ * Prints the smallest two-level tables of a value of every code point.
+ * @param prefix what the names of the tables begin with
+ * @param valueName the name of the second-level table, after prefix
+ * @param all the value of every code point
+ */
+void printTables(const char* prefix, const char* valueName, const std::vector<std::uint8_t>& all)
+{
+	Tables best;
+	std::size_t bestSize = SIZE_MAX;
+	for(unsigned shift = 4; shift <= 10; ++shift)
+	{
+		Tables tables = buildTables(all, shift);
+		std::size_t size = tables.blocks.size() * sizeof(std::uint16_t) + tables.values.size();
+		if(tables.values.size() >> shift <= UINT16_MAX && size < bestSize)
+		{
+			best = tables;
+			bestSize = size;
+		}
+	}
+
+	std::string blocks = std::string("std::uint16_t ") + prefix + "_BLOCKS";
+	std::string values = std::string("std::uint8_t ") + prefix + "_" + valueName;
+	std::printf("/* %s_BLOCKS and %s_%s take up %zu bytes */\n", prefix, prefix, valueName, bestSize);
+	std::printf("const unsigned %s_BLOCK_SHIFT = %u;\n\n", prefix, best.shift);
+	printArray(blocks.c_str(), best.blocks);
+	printArray(values.c_str(), best.values);
+}
+
+int main()
+{
+	std::vector<std::uint8_t> all(CODE_POINTS);
+	for(std::uint32_t c = 0; c < CODE_POINTS; ++c)
+	{
+		all[c] = properties(c);
+	}
+
+	std::printf("/* generated by gentables from the tables of libunistring: do not edit */\n");
+	std::printf("#include <cstdint>\n\n");
+	std::printf("#ifndef UNICODETABLES_H\n#define UNICODETABLES_H\n\n");
+	printTables("UNICODE", "PROPERTIES", all);
+	printTables("NFC", "CLASSES", nfcClasses());
+	std::vector<std::uint8_t> rules;
+	for(int previous = 0; previous <= GRAPHEME_BREAK_MASK; ++previous)
+	{
+		for(int next = 0; next <= GRAPHEME_BREAK_MASK; ++next)
+		{
+			rules.push_back(rule(previous, next));
+		}
+	}
+	printArray("std::uint8_t GRAPHEME_BREAK_RULES", rules);
+	std::printf("#endif /* UNICODETABLES_H */\n");
+
+	if(std::fflush(stdout) != 0 || std::ferror(stdout))
+	{
+		std::perror(nullptr);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
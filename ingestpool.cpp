@@ -0,0 +1,387 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "ingestpool.hpp"
+
+IngestPool::IngestPool(const char* delimiters, unsigned threadCount, const Summarizer::Options& options,
+                       const Sampling& sampling) :
+			samples(threadCount),
+			sampleSize(sampling.size),
+			deadline(sampling.budget != 0 ? now() + sampling.budget : 0),
+			expired(false),
+			blocks(threadCount * BLOCKS_PER_THREAD),
+			finished(false)
+{
+	// each sample starts out with the first sampleSize filenames it sees, then picks its first one to replace
+	for(std::size_t i = 0; i < samples.size(); ++i)
+	{
+		Sample& sample = samples[i];
+		sample.seen = 0;
+		sample.nextChosen = SIZE_MAX;
+		sample.threshold = 1;
+		sample.random.seed(i + 1);
+		if(sampleSize != 0)
+		{
+			std::uniform_real_distribution<double> uniform;
+			sample.threshold = std::exp(std::log(1 - uniform(sample.random)) / sampleSize);
+			double skip = std::floor(std::log(1 - uniform(sample.random)) / std::log1p(-sample.threshold));
+			sample.nextChosen = skip < SIZE_MAX / 2 ? sampleSize + (std::size_t) skip : SIZE_MAX;
+		}
+	}
+
+	for(auto it = blocks.begin(); it != blocks.end(); ++it)
+	{
+		it -> data = (char*) std::malloc(BLOCK_SIZE);
+		if(it -> data == nullptr)
+		{
+			std::perror(nullptr);
+			std::exit(EXIT_FAILURE);
+		}
+		it -> size = 0;
+		it -> capacity = BLOCK_SIZE;
+		freeBlocks.push_back(&*it);
+	}
+
+	// the shards are all constructed up front, before any worker thread starts using them
+	for(unsigned i = 0; i < threadCount; ++i)
+	{
+		shards.emplace_back(new Summarizer(delimiters, options));
+	}
+	for(unsigned i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back(&IngestPool::work, this, i);
+	}
+}
+
+IngestPool::~IngestPool()
+{
+	stopWorkers();
+	for(auto it = blocks.begin(); it != blocks.end(); ++it)
+	{
+		std::free(it -> data);
+	}
+}
+
+IngestPool::Block* IngestPool::acquireBlock()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(freeBlocks.empty())
+	{
+		blockFreed.wait(lock);
+	}
+
+	Block* block = freeBlocks.back();
+	freeBlocks.pop_back();
+	block -> size = 0;
+	block -> separator = '\0';
+	return block;
+}
+
+void IngestPool::growBlock(Block* block, std::size_t capacity)
+{
+	if(block -> capacity < capacity)
+	{
+		char* grown = (char*) std::realloc(block -> data, capacity);
+		if(grown == nullptr)
+		{
+			std::perror(nullptr);
+			std::exit(EXIT_FAILURE);
+		}
+		block -> data = grown;
+		block -> capacity = capacity;
+	}
+}
+
+void IngestPool::submitBlock(Block* block)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		submittedBlocks.push_back(block);
+	}
+	blockSubmitted.notify_one();
+}
+
+void IngestPool::submitRange(const char* data, std::size_t size, char separator)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// the workers only ever read from a block, so the range is never written to
+		Block range = {const_cast<char*>(data), size, 0, separator};
+		ranges.push_back(range);
+		submittedBlocks.push_back(&ranges.back());
+	}
+	blockSubmitted.notify_one();
+}
+
+Summarizer& IngestPool::finish()
+{
+	stopWorkers();
+
+	coverage.seen = 0;
+	for(auto it = samples.cbegin(); it != samples.cend(); ++it)
+	{
+		coverage.seen += it -> seen;
+	}
+	coverage.ingested = sampleSize != 0 ? std::min(sampleSize, coverage.seen) : coverage.seen;
+	coverage.expired = expired;
+	if(sampleSize != 0)
+	{
+		ingestSample();
+	}
+
+	std::vector<Summarizer*> shardPointers;
+	for(auto it = shards.begin(); it != shards.end(); ++it)
+	{
+		shardPointers.push_back(it -> get());
+	}
+	{
+		StageTimer timer(shards.front() -> getStats(), Stats::MERGE);
+		mergeTree(shardPointers);
+	}
+
+	return *shards.front();
+}
+
+void IngestPool::mergeTree(std::vector<Summarizer*>& shards)
+{
+	// in each round, shard i absorbs shard i + stride, for every i that is a multiple of 2 * stride
+	for(std::size_t stride = 1; stride < shards.size(); stride *= 2)
+	{
+		std::vector<std::thread> mergers;
+		for(std::size_t i = 0; i + stride < shards.size(); i += 2 * stride)
+		{
+			Summarizer* into = shards[i];
+			Summarizer* from = shards[i + stride];
+			mergers.emplace_back([into, from]() { into -> merge(*from); });
+		}
+		for(auto it = mergers.begin(); it != mergers.end(); ++it)
+		{
+			it -> join();
+		}
+	}
+}
+
+bool IngestPool::isExpired()
+{
+	if(deadline == 0)
+	{
+		return false;
+	}
+	if(!expired.load(std::memory_order_relaxed) && now() >= deadline)
+	{
+		expired = true;
+	}
+	return expired.load(std::memory_order_relaxed);
+}
+
+void IngestPool::work(std::size_t index)
+{
+	Summarizer* shard = shards[index].get();
+	Sample& sample = samples[index];
+	while(true)
+	{
+		Block* block;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(submittedBlocks.empty() && !finished)
+			{
+				blockSubmitted.wait(lock);
+			}
+			if(submittedBlocks.empty())
+			{
+				// finished, and there is nothing left to ingest
+				return;
+			}
+
+			block = submittedBlocks.front();
+			submittedBlocks.pop_front();
+		}
+
+		// ingest the filenames straight out of the block, without copying them anywhere, until the time budget runs
+		// out, after which the rest of the filenames submitted are dropped
+		const char* filename = block -> data;
+		const char* blockEnd = block -> data + block -> size;
+		std::size_t checked = 0;
+		while(filename < blockEnd)
+		{
+			if(checked++ % FILENAMES_PER_CHECK == 0 && isExpired())
+			{
+				break;
+			}
+
+			const char* separator = (const char*) std::memchr(filename, block -> separator, blockEnd - filename);
+			if(separator == nullptr)
+			{
+				// the last filename in a block is allowed to go without a separator
+				separator = blockEnd;
+			}
+			if(separator != filename)
+			{
+				if(sampleSize != 0)
+				{
+					offer(sample, filename, separator - filename);
+				}
+				else
+				{
+					shard -> inputFilename(filename, separator - filename);
+				}
+				++sample.seen;
+			}
+			filename = separator + 1;
+		}
+
+		if(block -> capacity == 0)
+		{
+			// the range's data belongs to the caller, so there is no block to hand back out
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeBlocks.push_back(block);
+		}
+		blockFreed.notify_one();
+	}
+}
+
+void IngestPool::offer(Sample& sample, const char* filename, std::size_t length) const
+{
+	if(sample.names.size() < sampleSize)
+	{
+		sample.names.emplace_back(filename, length);
+		return;
+	}
+	if(sample.seen != sample.nextChosen)
+	{
+		return;
+	}
+
+	// the chosen filename replaces a random one, and the number of filenames to skip before the next one is chosen
+	// follows from the new threshold
+	std::uniform_int_distribution<std::size_t> position(0, sampleSize - 1);
+	std::uniform_real_distribution<double> uniform;
+	sample.names[position(sample.random)].assign(filename, length);
+	sample.threshold *= std::exp(std::log(1 - uniform(sample.random)) / sampleSize);
+	double skip = std::floor(std::log(1 - uniform(sample.random)) / std::log1p(-sample.threshold));
+	sample.nextChosen = skip < SIZE_MAX / 2 - sample.seen ? sample.seen + 1 + (std::size_t) skip : SIZE_MAX;
+}
+
+void IngestPool::ingestSample()
+{
+	// draw filenames one at a time from the union of the samples without replacement: each draw comes from a worker
+	// thread's sample in proportion to the filenames it saw which have not been drawn yet, and is a random filename
+	// from that sample which has not been drawn yet either. A uniform sample of a uniform sample is uniform too
+	std::vector<std::size_t> undrawnSeen;
+	std::vector<std::size_t> undrawnNames;
+	for(auto it = samples.cbegin(); it != samples.cend(); ++it)
+	{
+		undrawnSeen.push_back(it -> seen);
+		undrawnNames.push_back(it -> names.size());
+	}
+	std::mt19937_64& random = samples.front().random;
+	std::vector<const char*> drawn;
+	for(std::size_t left = coverage.seen; drawn.size() < coverage.ingested; --left)
+	{
+		std::size_t draw = std::uniform_int_distribution<std::size_t>(0, left - 1)(random);
+		std::size_t i = 0;
+		while(draw >= undrawnSeen[i])
+		{
+			draw -= undrawnSeen[i++];
+		}
+		--undrawnSeen[i];
+
+		std::vector<std::string>& names = samples[i].names;
+		std::size_t position = std::uniform_int_distribution<std::size_t>(0, undrawnNames[i] - 1)(random);
+		std::swap(names[position], names[--undrawnNames[i]]);
+		drawn.push_back(names[undrawnNames[i]].c_str());
+	}
+
+	// the sample is split evenly between the shards, which are merged as usual afterwards
+	std::vector<std::thread> ingesters;
+	for(std::size_t i = 0; i < shards.size(); ++i)
+	{
+		std::size_t begin = drawn.size() * i / shards.size();
+		std::size_t end = drawn.size() * (i + 1) / shards.size();
+		Summarizer* shard = shards[i].get();
+		const char* const* first = drawn.data() + begin;
+		ingesters.emplace_back([shard, first, begin, end]() { shard -> inputFilenames(first, end - begin); });
+	}
+	for(auto it = ingesters.begin(); it != ingesters.end(); ++it)
+	{
+		it -> join();
+	}
+}
+
+long long IngestPool::now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+void IngestPool::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = true;
+	}
+	blockSubmitted.notify_all();
+
+	for(auto it = workers.begin(); it != workers.end(); ++it)
+	{
+		it -> join();
+	}
+	workers.clear();
+}
+
+void BlockWriter::inputFilename(const char* filename, std::size_t length)
+{
+	if(block != nullptr && block -> size + length + 1 > block -> capacity)
+	{
+		flush();
+	}
+	if(block == nullptr)
+	{
+		block = pool.acquireBlock();
+	}
+
+	// this filename may be longer than any block so far
+	IngestPool::growBlock(block, length + 1);
+
+	std::memcpy(block -> data + block -> size, filename, length);
+	block -> data[block -> size + length] = '\0';
+	block -> size += length + 1;
+}
+
+void BlockWriter::flush()
+{
+	if(block != nullptr)
+	{
+		pool.submitBlock(block);
+		block = nullptr;
+	}
+}
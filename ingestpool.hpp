@@ -0,0 +1,259 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <atomic>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "summarizer.hpp"
+
+#ifndef INGESTPOOL_H
+#define INGESTPOOL_H
+
+/*
+ * Spreads the ingestion of filenames over several worker threads. Each worker owns a private Summarizer (a "shard"),
+ * so no locking happens per filename; filenames are handed to the workers in large blocks instead. Once all blocks
+ * have been submitted, the shards are merged into a single Summarizer whose summary is identical to that of a
+ * single Summarizer which ingested every filename itself.
+ * For a quick, approximate pattern, the pool can instead ingest a uniform random sample of the filenames, and/or stop
+ * taking filenames once a time budget runs out, which the code submitting filenames can check to stop reading early.
+ */
+class IngestPool
+{
+	public:
+		/*
+		 * A buffer of filenames, each one followed by the separator character. Empty filenames are skipped.
+		 */
+		struct Block
+		{
+			char* data; /* the filenames */
+			std::size_t size; /* the number of bytes of data in use */
+			std::size_t capacity; /* the number of bytes allocated for data, or 0 if data belongs to the caller, as with
+			                         IngestPool::submitRange */
+			char separator; /* the character that ends each filename in data */
+		};
+
+		/*
+		 * Limits on how many of the filenames submitted are ingested.
+		 */
+		struct Sampling
+		{
+			std::size_t size; /* the most filenames to ingest, chosen uniformly at random from all those seen, or 0 to
+			                     ingest every filename */
+			long long budget; /* the number of nanoseconds, from the construction of the IngestPool, after which no
+			                     more filenames are seen, or 0 for no limit */
+
+			Sampling() : size(0), budget(0) {}
+		};
+
+		/*
+		 * How much of the input went into the pattern, as limited by Sampling.
+		 */
+		struct Coverage
+		{
+			std::size_t seen; /* the number of filenames ingested or considered for the sample */
+			std::size_t ingested; /* the number of those filenames which were ingested */
+			bool expired; /* whether the time budget ran out, so that some filenames may never have been seen */
+		};
+
+		/*
+		 * Constructs an IngestPool object, and starts its worker threads.
+		 * @param delimiters passed on to the constructor of each worker's Summarizer
+		 * @param threadCount the number of worker threads to start. Must be at least 1
+		 * @param options passed on to the constructor of each worker's Summarizer
+		 * @param sampling limits on how many of the filenames submitted are ingested
+		 */
+		IngestPool(const char* delimiters, unsigned threadCount,
+		           const Summarizer::Options& options = Summarizer::Options(), const Sampling& sampling = Sampling());
+
+		/*
+		 * Stops the worker threads if IngestPool::finish was never called, and frees all blocks.
+		 */
+		~IngestPool();
+
+		/*
+		 * Returns an empty block for the caller to fill with filenames, then pass to IngestPool::submitBlock.
+		 * Only a fixed number of blocks exist, so this waits until the workers have finished with one, if necessary.
+		 * @return an empty block, with its separator set to '\0'
+		 */
+		Block* acquireBlock();
+
+		/*
+		 * Makes a block big enough to hold at least capacity bytes, keeping the data already in it.
+		 * @param block a block obtained from IngestPool::acquireBlock
+		 * @param capacity the number of bytes which block must be able to hold
+		 */
+		static void growBlock(Block* block, std::size_t capacity);
+
+		/*
+		 * Queues up a block of filenames to be ingested by the next free worker thread. The block is returned to the
+		 * pool once it has been ingested, and must not be touched by the caller afterwards.
+		 * @param block a block obtained from IngestPool::acquireBlock
+		 */
+		void submitBlock(Block* block);
+
+		/*
+		 * Queues up a range of filenames which the caller already has in memory, e.g. in a mapped file, to be ingested
+		 * by the next free worker thread straight from where they are, without copying them into a block.
+		 * @param data the filenames, each one followed by separator, except perhaps the last one. Must stay valid and
+		 *        unchanged until IngestPool::finish returns
+		 * @param size the number of bytes in data
+		 * @param separator the character that ends each filename in data
+		 */
+		void submitRange(const char* data, std::size_t size, char separator);
+
+		/*
+		 * Waits for every submitted block to be ingested, stops the worker threads, and merges all shards together.
+		 * No more blocks may be submitted afterwards.
+		 * @return the Summarizer holding the pattern of every filename that was submitted, or of the sample of them
+		 */
+		Summarizer& finish();
+
+		/*
+		 * Checks whether the time budget has run out, after which the filenames in submitted blocks are dropped
+		 * without being seen, so there is no point in reading any more of them.
+		 * @return true if there is a time budget and it has run out; false otherwise
+		 */
+		bool isExpired();
+
+		/*
+		 * @return how much of the input went into the Summarizer returned by IngestPool::finish. Only valid once it
+		 *         has been called
+		 */
+		const Coverage& getCoverage() const { return coverage; }
+
+		/*
+		 * Merges every Summarizer in shards into the first one, by merging pairs of them on separate threads, in rounds.
+		 * @param shards the Summarizers to merge. Must not be empty
+		 */
+		static void mergeTree(std::vector<Summarizer*>& shards);
+	private:
+		/* the amount of bytes allocated for each block to begin with */
+		static const std::size_t BLOCK_SIZE = 1 << 20;
+
+		/* the amount of blocks allotted to each worker thread. Bounds the memory used, however many filenames there are */
+		static const unsigned BLOCKS_PER_THREAD = 4;
+
+		/* the number of filenames a worker thread ingests between checks of the time budget */
+		static const std::size_t FILENAMES_PER_CHECK = 1024;
+
+		/*
+		 * A uniform random sample of the filenames seen by one worker thread, kept up to date with Algorithm L
+		 * (Li, 1994), which skips over the filenames that will not be chosen without drawing a random number for each.
+		 */
+		struct Sample
+		{
+			std::vector<std::string> names; /* the filenames chosen so far */
+			std::size_t seen; /* the number of filenames seen by the worker thread */
+			std::size_t nextChosen; /* the value of seen when the next filename to be chosen is seen */
+			double threshold; /* the largest of the random keys of the filenames chosen so far, as in Algorithm L */
+			std::mt19937_64 random; /* seeded per worker thread, so that a single thread samples reproducibly */
+		};
+
+		std::vector<std::unique_ptr<Summarizer>> shards; /* one Summarizer per worker thread */
+		std::vector<Sample> samples; /* one sample per worker thread */
+		const std::size_t sampleSize; /* the most filenames to ingest, or 0 to ingest all of them */
+		const long long deadline; /* the time on IngestPool::now's clock when the time budget runs out, or 0 */
+		std::atomic<bool> expired; /* set once the time budget is known to have run out */
+		Coverage coverage; /* set by IngestPool::finish */
+		std::vector<std::thread> workers; /* the worker threads */
+		std::vector<Block> blocks; /* every block, whether free or in use */
+		std::vector<Block*> freeBlocks; /* blocks which can be handed out by IngestPool::acquireBlock */
+		std::deque<Block> ranges; /* blocks pointing at the ranges submitted by IngestPool::submitRange */
+		std::deque<Block*> submittedBlocks; /* blocks waiting to be ingested by a worker thread */
+		bool finished; /* set once no more blocks will be submitted */
+
+		std::mutex mutex; /* guards freeBlocks, ranges, submittedBlocks and finished */
+		std::condition_variable blockFreed; /* signalled when a block is added to freeBlocks */
+		std::condition_variable blockSubmitted; /* signalled when a block is added to submittedBlocks, or finished is set */
+
+		/*
+		 * The body of each worker thread: ingests submitted blocks into its shard, or adds them to its sample, until
+		 * IngestPool::finish is called.
+		 * @param index the index of this worker thread's shard and sample
+		 */
+		void work(std::size_t index);
+
+		/*
+		 * Offers a filename to a worker thread's sample, which keeps a copy of it if it is chosen.
+		 * @param sample the sample. Its count of filenames seen must not include this one yet
+		 * @param filename the filename. Does not need to be NUL-terminated
+		 * @param length the number of bytes in filename
+		 */
+		void offer(Sample& sample, const char* filename, std::size_t length) const;
+
+		/*
+		 * Draws a uniform sample of sampleSize filenames from the union of every worker thread's sample, and ingests it
+		 * into the shards, spread over several threads.
+		 */
+		void ingestSample();
+
+		/*
+		 * @return the time on a clock which only moves forwards, in nanoseconds
+		 */
+		static long long now();
+
+		/*
+		 * Stops the worker threads and waits for them to exit.
+		 */
+		void stopWorkers();
+};
+
+/*
+ * Fills blocks from an IngestPool with filenames one at a time, submitting each block once it is full.
+ */
+class BlockWriter
+{
+	public:
+		/*
+		 * Constructs a BlockWriter object.
+		 * @param _pool the IngestPool to take blocks from and submit them to
+		 */
+		BlockWriter(IngestPool& _pool) : pool(_pool), block(nullptr) {}
+
+		/*
+		 * Submits the block currently being filled, if any.
+		 */
+		~BlockWriter() { flush(); }
+
+		/*
+		 * Copies a filename into the current block.
+		 * @param filename the filename to be ingested into the pattern. Does not need to be NUL-terminated
+		 * @param length the number of bytes in filename
+		 */
+		void inputFilename(const char* filename, std::size_t length);
+
+		/*
+		 * Submits the block currently being filled, if any.
+		 */
+		void flush();
+	private:
+		IngestPool& pool; /* the pool which blocks come from */
+		IngestPool::Block* block; /* the block currently being filled */
+};
+
+#endif /* INGESTPOOL_H */
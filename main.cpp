@@ -19,45 +19,379 @@
 * along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
 */
+#include <cerrno>
+#include <climits>
+#include <clocale>
+#include <cstdint>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <getopt.h>
 #include <unistd.h>
-#include <dirent.h>
 #include "summarizer.hpp"
+#include "ingestpool.hpp"
+#include "streamreader.hpp"
+#include "dirwalker.hpp"
+#include "patterncache.hpp"
+#include "dirwatcher.hpp"
+#include "statemerger.hpp"
+#include "patternwriter.hpp"
+#include "manifestreader.hpp"
 
-const char* USAGE = "Usage: %s [OPTION]... DIRECTORY\n";
+const char* USAGE = "Usage: %s [OPTION]... [DIRECTORY]\n  or:  %s [OPTION]... --from-file FILE\n"
+                    "  or:  %s [OPTION]... --merge FILE...\n";
 
 // called if the user supplies badly formed arguments to the program
 void printUsageAndExit(char** argv)
 {
-	std::fprintf(stderr, USAGE, argv[0]);
+	std::fprintf(stderr, USAGE, argv[0], argv[0], argv[0]);
 	std::fprintf(stderr, "Or try '%s -h' for more information.\n", argv[0]);
 	std::exit(EXIT_FAILURE);
 }
 
+// prints the pattern, as a grid or in a machine-readable format, or saves it to a state file instead, followed by the
+// stats if they were asked for
+void outputSummary(Summarizer& summarizer, const char* statePath, bool structured, PatternWriter::Format format,
+                   const Summarizer::Layout& layout, bool stats, bool jsonStats)
+{
+	int error = summarizer.getStatus();
+	if(statePath == nullptr && !structured)
+	{
+		summarizer.setLayout(layout);
+		error = summarizer.printSummary();
+	}
+	else if(statePath == nullptr && error == 0)
+	{
+		// the pattern is written out as it is visited, without being rendered first
+		StageTimer timer(summarizer.getStats(), Stats::RENDER);
+		PatternWriter writer(STDOUT_FILENO, format, layout.counts != Summarizer::Layout::NO_COUNTS);
+		summarizer.visitPattern(writer);
+		error = writer.finish();
+	}
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+	if(statePath != nullptr)
+	{
+		StateMerger::save(summarizer, statePath);
+	}
+	if(stats)
+	{
+		summarizer.printStats(jsonStats);
+	}
+}
+
+// tells the user that the pattern only covers part of the input, if it does
+void printCoverage(const IngestPool::Coverage& coverage)
+{
+	if(coverage.ingested == coverage.seen && !coverage.expired)
+	{
+		return;
+	}
+	std::fprintf(stderr, "approximate pattern of %zu of the %zu filenames seen (%.3g%%)%s\n", coverage.ingested,
+	             coverage.seen, coverage.seen == 0 ? 100.0 : 100.0 * coverage.ingested / coverage.seen,
+	             coverage.expired ? ", out of time before every filename was read" : "");
+}
+
+// values returned by getopt_long for the options which only have a long form
+enum LongOption
+{
+	MAX_UNIQUE_OPTION = 256,
+	CACHE_OPTION,
+	WATCH_OPTION,
+	STATS_OPTION,
+	EMIT_STATE_OPTION,
+	MERGE_OPTION,
+	FORMAT_OPTION,
+	COUNTS_OPTION,
+	ALIGN_OPTION,
+	SORT_OPTION,
+	TOP_OPTION,
+	SAMPLE_OPTION,
+	TIME_BUDGET_OPTION,
+	SHARE_PREFIXES_OPTION,
+	FROM_FILE_OPTION
+};
+
+const option LONG_OPTIONS[] = {
+	{"max-unique", required_argument, nullptr, MAX_UNIQUE_OPTION},
+	{"cache", required_argument, nullptr, CACHE_OPTION},
+	{"watch", no_argument, nullptr, WATCH_OPTION},
+	{"stats", optional_argument, nullptr, STATS_OPTION},
+	{"emit-state", required_argument, nullptr, EMIT_STATE_OPTION},
+	{"merge", no_argument, nullptr, MERGE_OPTION},
+	{"format", required_argument, nullptr, FORMAT_OPTION},
+	{"counts", optional_argument, nullptr, COUNTS_OPTION},
+	{"align", optional_argument, nullptr, ALIGN_OPTION},
+	{"sort", required_argument, nullptr, SORT_OPTION},
+	{"top", required_argument, nullptr, TOP_OPTION},
+	{"sample", required_argument, nullptr, SAMPLE_OPTION},
+	{"time-budget", required_argument, nullptr, TIME_BUDGET_OPTION},
+	{"share-prefixes", no_argument, nullptr, SHARE_PREFIXES_OPTION},
+	{"from-file", required_argument, nullptr, FROM_FILE_OPTION},
+	{nullptr, 0, nullptr, 0}
+};
+
 int main(int argc, char* argv[])
 {
+	// filenames and delimiters are in the user's locale, which every Summarizer uses from here on
+	std::setlocale(LC_ALL, "");
+
 	int option;
 	char* delimiters = nullptr;
-	while((option = getopt(argc, argv, "d:h")) != -1)
+	unsigned long threadCount = 1;
+	char separator = '\n';
+	bool recursive = false;
+	bool relativePaths = false;
+	Summarizer::Options options;
+	unsigned long long maxUnique;
+	unsigned long alignBand;
+	const char* cachePath = nullptr;
+	bool watch = false;
+	bool stats = false;
+	bool jsonStats = false;
+	const char* statePath = nullptr;
+	const char* manifestPath = nullptr;
+	bool merge = false;
+	bool structured = false;
+	PatternWriter::Format format = PatternWriter::JSON;
+	Summarizer::Layout layout;
+	unsigned long long top;
+	IngestPool::Sampling sampling;
+	unsigned long long sampleSize;
+	unsigned long long budget;
+	char* end;
+	while((option = getopt_long(argc, argv, "0d:hj:pr", LONG_OPTIONS, nullptr)) != -1)
 	{
 		switch(option) 
 		{
+			case '0':
+				separator = '\0';
+				break;
 			case 'd': 
 				delimiters = optarg;
 				break;
+			case 'p':
+				relativePaths = true;
+				break;
+			case 'r':
+				recursive = true;
+				break;
+			case 'j':
+				threadCount = std::strtoul(optarg, &end, 10);
+				if(*end != '\0' || threadCount == 0 || threadCount > UINT_MAX)
+				{
+					printUsageAndExit(argv);
+				}
+				break;
+			case MAX_UNIQUE_OPTION:
+				maxUnique = std::strtoull(optarg, &end, 10);
+				if(*end != '\0' || maxUnique == 0 || maxUnique > UINT_MAX / 4)
+				{
+					printUsageAndExit(argv);
+				}
+				options.maxUnique = maxUnique;
+				break;
+			case CACHE_OPTION:
+				cachePath = optarg;
+				break;
+			case WATCH_OPTION:
+				watch = true;
+				break;
+			case STATS_OPTION:
+#ifdef PATTERN_NO_STATS
+				// nothing is timed or counted in this build, so there would only be zeros to print
+				std::fprintf(stderr, "%s was built without --stats support\n", argv[0]);
+				std::exit(EXIT_FAILURE);
+#endif
+				stats = true;
+				if(optarg != nullptr)
+				{
+					if(std::strcmp(optarg, "json") != 0)
+					{
+						printUsageAndExit(argv);
+					}
+					jsonStats = true;
+				}
+				break;
+			case EMIT_STATE_OPTION:
+				statePath = optarg;
+				break;
+			case MERGE_OPTION:
+				merge = true;
+				break;
+			case FORMAT_OPTION:
+				structured = std::strcmp(optarg, "grid") != 0;
+				if(std::strcmp(optarg, "json") == 0)
+				{
+					format = PatternWriter::JSON;
+				}
+				else if(std::strcmp(optarg, "ndjson") == 0)
+				{
+					format = PatternWriter::NDJSON;
+				}
+				else if(std::strcmp(optarg, "bin") == 0)
+				{
+					format = PatternWriter::BINARY;
+				}
+				else if(structured)
+				{
+					printUsageAndExit(argv);
+				}
+				break;
+			case COUNTS_OPTION:
+				layout.counts = Summarizer::Layout::COUNTS;
+				if(optarg != nullptr)
+				{
+					if(std::strcmp(optarg, "percent") != 0)
+					{
+						printUsageAndExit(argv);
+					}
+					layout.counts = Summarizer::Layout::PERCENTAGES;
+				}
+				break;
+			case ALIGN_OPTION:
+				options.alignBand = 3;
+				if(optarg != nullptr)
+				{
+					alignBand = std::strtoul(optarg, &end, 10);
+					if(*end != '\0' || alignBand == 0 || alignBand > UINT_MAX / 4)
+					{
+						printUsageAndExit(argv);
+					}
+					options.alignBand = alignBand;
+				}
+				break;
+			case SORT_OPTION:
+				layout.byFrequency = std::strcmp(optarg, "freq") == 0;
+				if(!layout.byFrequency && std::strcmp(optarg, "lex") != 0)
+				{
+					printUsageAndExit(argv);
+				}
+				break;
+			case TOP_OPTION:
+				top = std::strtoull(optarg, &end, 10);
+				if(*end != '\0' || top == 0 || top > SIZE_MAX)
+				{
+					printUsageAndExit(argv);
+				}
+				layout.top = top;
+				break;
+			case SAMPLE_OPTION:
+				sampleSize = std::strtoull(optarg, &end, 10);
+				if(*end != '\0' || sampleSize == 0 || sampleSize > SIZE_MAX / 2)
+				{
+					printUsageAndExit(argv);
+				}
+				sampling.size = sampleSize;
+				break;
+			case TIME_BUDGET_OPTION:
+				budget = std::strtoull(optarg, &end, 10);
+				if(*end != '\0' || budget == 0 || budget > LLONG_MAX / 1000000 / 2)
+				{
+					printUsageAndExit(argv);
+				}
+				sampling.budget = budget * 1000000;
+				break;
+			case SHARE_PREFIXES_OPTION:
+				options.sharePrefixes = true;
+				break;
+			case FROM_FILE_OPTION:
+				manifestPath = optarg;
+				break;
             case 'h':
-                std::printf(USAGE, argv[0]);
+                std::printf(USAGE, argv[0], argv[0], argv[0]);
                 std::puts("");
-                std::puts("Summarize the pattern of the filenames in DIRECTORY:");
+                std::puts("Summarize the pattern of the filenames in DIRECTORY, or of the filenames read");
+                std::puts("from standard input, one per line, if no DIRECTORY is given:");
                 std::puts("slice each filename into substrings, group together the Nth substrings from");
                 std::puts("every filename, and print the unique substrings found in each of the N groups.");
                 std::puts("");
+                std::puts("  -0\t\tfilenames read from standard input or FILE are separated by NUL");
+                std::puts("\t\tcharacters instead of newlines, as with find -print0");
                 std::puts("  -d=DELIMITERS\tdivide the filenames into substrings split by the characters");
                 std::puts("\t\tin DELIMITERS; each user-perceived character (a.k.a. grapheme");
                 std::puts("\t\tcluster) in DELIMITERS is considered a separate delimiter");
                 std::puts("  -h\t\tdisplay this help text and exit");
+                std::puts("  -j=THREADS\tingest the filenames on THREADS threads at once, and read");
+                std::puts("\t\tsubdirectories on THREADS threads at once with -r (default 1)");
+                std::puts("  -p\t\tuse the path of each file relative to DIRECTORY instead of");
+                std::puts("\t\tjust its name, e.g. with -r");
+                std::puts("  -r\t\tinclude the files in all subdirectories of DIRECTORY,");
+                std::puts("\t\trecursively");
+                std::puts("  --cache=FILE\tsave the pattern of DIRECTORY in FILE, and on later runs,");
+                std::puts("\t\treuse it if DIRECTORY is unchanged, or else only ingest the");
+                std::puts("\t\tfilenames added or removed since (cannot be combined with");
+                std::puts("\t\t--max-unique)");
+                std::puts("  --watch\tkeep the pattern of DIRECTORY on screen, redrawing it as files");
+                std::puts("\t\tare created, renamed and deleted, until DIRECTORY is deleted");
+                std::puts("\t\t(cannot be combined with any other option but -d, -j, -p,");
+                std::puts("\t\t--counts, --sort, --top or --share-prefixes)");
+#ifndef PATTERN_NO_STATS
+                std::puts("  --stats[=json]");
+                std::puts("\t\tprint the time spent in each stage, counts of what happened,");
+                std::puts("\t\tand the number of unique substrings in each group to standard");
+                std::puts("\t\terror after the pattern, as a table or as JSON (cannot be");
+                std::puts("\t\tcombined with --watch or --cache)");
+#endif
+                std::puts("  --emit-state=FILE");
+                std::puts("\t\tsave the pattern to FILE instead of printing it, so that");
+                std::puts("\t\t--merge can combine it with the patterns of other scans");
+                std::puts("  --merge\tprint the pattern of all the filenames in the FILEs given");
+                std::puts("\t\tinstead of DIRECTORY, each saved by --emit-state with the same");
+                std::puts("\t\t-d and --max-unique in the same locale, loading THREADS FILEs");
+                std::puts("\t\tat once with -j (cannot be combined with --watch or --cache)");
+                std::puts("  --format=FORMAT");
+                std::puts("\t\tprint the pattern as a grid (the default), or as FORMAT 'json',");
+                std::puts("\t\t'ndjson' or 'bin': the unique utf-8 substrings of each group and");
+                std::puts("\t\ttheir widths, in no particular order (cannot be combined with");
+                std::puts("\t\t--watch, --cache or --emit-state)");
+                std::puts("  --counts[=percent]");
+                std::puts("\t\tprint the number of filenames which have each substring in its");
+                std::puts("\t\tgroup beside it, or with 'percent', their percentage of all the");
+                std::puts("\t\tfilenames (only the number with --format); counts marked as");
+                std::puts("\t\tapproximate may be overestimated, because of --max-unique");
+                std::puts("  --sort=ORDER\tprint the substrings of each group in ORDER 'lex',");
+                std::puts("\t\talphabetical (the default), or 'freq', those found in the most");
+                std::puts("\t\tfilenames first");
+                std::puts("  --top=N\tprint only the N substrings of each group found in the most");
+                std::puts("\t\tfilenames, followed by the number left out");
+                std::puts("  --max-unique=K");
+                std::puts("\t\tkeep at most K unique substrings of any group exactly; past");
+                std::puts("\t\tthat, print the group's approximate number of unique substrings,");
+                std::puts("\t\tand those of its substrings certain to be found more than once,");
+                std::puts("\t\tout of the K most frequent, using memory bounded by K");
+                std::puts("  --align[=BAND]");
+                std::puts("\t\tinstead of putting the Nth substring of every filename in the");
+                std::puts("\t\tNth group, line up each filename's substrings with the groups");
+                std::puts("\t\tthey are already found in, up to BAND groups away (default 3),");
+                std::puts("\t\tadding groups for substrings found in none; an extra or missing");
+                std::puts("\t\tsubstring then does not shift the ones after it (cannot be");
+                std::puts("\t\tcombined with --watch, --cache, --emit-state or --merge)");
+                std::puts("  --sample=N\tprint the pattern of only N filenames, chosen at random from");
+                std::puts("\t\tall of them, noting on standard error how many that was out of");
+                std::puts("\t\t(cannot be combined with --watch, --cache, --emit-state or");
+                std::puts("\t\t--merge)");
+                std::puts("  --time-budget=MS");
+                std::puts("\t\tstop reading filenames MS milliseconds after starting, and print");
+                std::puts("\t\tthe pattern of those read so far, or of a sample of them with");
+                std::puts("\t\t--sample, noting on standard error if some were left unread");
+                std::puts("\t\t(cannot be combined with --watch, --cache, --emit-state or");
+                std::puts("\t\t--merge)");
+                std::puts("  --share-prefixes");
+                std::puts("\t\tremember how the start of each filename was split, and only");
+                std::puts("\t\tsplit the rest of a later filename which starts the same way,");
+                std::puts("\t\twhich is faster when many filenames share long prefixes; the");
+                std::puts("\t\tpattern is the same (no effect with --max-unique or --align)");
+                std::puts("  --from-file=FILE");
+                std::puts("\t\tread the filenames from FILE instead of DIRECTORY or standard");
+                std::puts("\t\tinput, one per line (or NUL-separated with -0), ingesting parts");
+                std::puts("\t\tof a large FILE on THREADS threads at once straight from memory");
+                std::puts("\t\t(cannot be combined with --watch, --cache or --merge)");
                 std::puts("");
                 std::puts("Without a DELIMITERS argument, each user-perceived character of every");
                 std::puts("filename is its own substring by default.");
@@ -80,39 +414,103 @@ int main(int argc, char* argv[])
     (w.ws_col)
     */
 
-	Summarizer summarizer(delimiters);
-	if(optind >= argc)
+	// only the grid can be kept on screen or printed from a cache, and a saved state is not printed at all. The
+	// substrings of the other formats are in no particular order, and their counts are only ever plain numbers
+	if(structured && (watch || cachePath != nullptr || statePath != nullptr))
 	{
-		// no directory given as an argument, so check for a list of filenames from stdin
-		if(isatty(STDIN_FILENO))
+		printUsageAndExit(argv);
+	}
+	if((structured && (layout.counts == Summarizer::Layout::PERCENTAGES || layout.byFrequency || layout.top != 0)) ||
+	   (statePath != nullptr && layout.usesCounts()))
+	{
+		printUsageAndExit(argv);
+	}
+
+	// a partial pattern is only printed straight away, never kept up to date, saved or merged with another
+	if((sampling.size != 0 || sampling.budget != 0) && (watch || cachePath != nullptr || statePath != nullptr || merge))
+	{
+		printUsageAndExit(argv);
+	}
+
+	// a saved list of filenames stands in for the directory or standard input, and is only ever read once
+	if(manifestPath != nullptr && (optind < argc || watch || cachePath != nullptr || merge))
+	{
+		printUsageAndExit(argv);
+	}
+
+	if(watch)
+	{
+		// only the directory itself is watched, and sketched groups cannot forget removed filenames
+		if(optind >= argc || recursive || cachePath != nullptr || options.maxUnique != 0 || stats ||
+		   statePath != nullptr || merge || options.alignBand != 0)
 		{
 			printUsageAndExit(argv);
 		}
-		//TODO: handle stdin. Check for empty strings and don't process them
+		DirectoryWatcher watcher(delimiters, options, layout, threadCount);
+		watcher.watch(argv[optind]);
+		return EXIT_SUCCESS;
 	}
-	else
+
+	if(cachePath != nullptr)
 	{
-		DIR* dir = opendir(argv[optind]);
-		if(dir == nullptr)
+		// a cache is only kept for a directory, and sketched groups cannot forget removed filenames
+		if(optind >= argc || options.maxUnique != 0 || stats || statePath != nullptr || merge ||
+		   options.alignBand != 0)
 		{
-			std::perror(nullptr);
-			std::exit(EXIT_FAILURE);
+			printUsageAndExit(argv);
 		}
+		PatternCache cache(cachePath);
+		cache.summarize(argv[optind], delimiters, recursive, relativePaths, threadCount, layout);
+		return EXIT_SUCCESS;
+	}
 
-        // read all filenames from the supplied directory, and feed them into the summarizer
-		dirent* ent;
-        char* filename;
-		while((ent = readdir(dir)) != nullptr)
+	// stats are only enabled once the Summarizers are constructed, so as not to count their own setup
+	if(merge)
+	{
+		if(optind >= argc || options.alignBand != 0)
 		{
-            filename = ent->d_name;
-            if(std::strcmp(".", filename) && std::strcmp("..", filename)) //ignore the "." and ".." in the directory
-            {
-                summarizer.inputFilename(filename);
-            }
+			printUsageAndExit(argv);
 		}
+		StateMerger merger(argv + optind, argc - optind, delimiters, options, threadCount);
+		Stats::enabled = stats;
+		outputSummary(merger.merge(), statePath, structured, format, layout, stats, jsonStats);
+		return EXIT_SUCCESS;
+	}
 
-		closedir(dir);
+	// aligned columns do not match up between patterns, so an aligned pattern cannot be merged later, and the
+	// filenames are all ingested into a single one, while the directories are still read on THREADS threads
+	if(options.alignBand != 0 && statePath != nullptr)
+	{
+		printUsageAndExit(argv);
+	}
+	Stats readStats;
+	// the file is opened before any threads are started, and stays mapped until the pool has finished ingesting it
+	std::unique_ptr<ManifestReader> manifest(manifestPath != nullptr ? new ManifestReader(manifestPath) : nullptr);
+	IngestPool pool(delimiters, options.alignBand != 0 ? 1 : threadCount, options, sampling);
+	Stats::enabled = stats;
+	if(manifest != nullptr)
+	{
+		manifest -> ingest(pool, separator);
+	}
+	else if(optind >= argc)
+	{
+		// no directory given as an argument, so check for a list of filenames from stdin
+		if(isatty(STDIN_FILENO))
+		{
+			printUsageAndExit(argv);
+		}
+		ingestStream(pool, STDIN_FILENO, separator);
+	}
+	else
+	{
+        // read all filenames from the supplied directory, and feed them into the summarizer
+		DirectoryWalker walker(pool, recursive, relativePaths, threadCount);
+		walker.walk(argv[optind]);
+		readStats.merge(walker.getStats());
 	}
 
-	summarizer.printSummary();
+	Summarizer& summarizer = pool.finish();
+	summarizer.getStats().merge(readStats);
+	outputSummary(summarizer, statePath, structured, format, layout, stats, jsonStats);
+	printCoverage(pool.getCoverage());
 }
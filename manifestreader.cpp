@@ -0,0 +1,96 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "manifestreader.hpp"
+#include "streamreader.hpp"
+
+const std::size_t ManifestReader::RANGE_SIZE;
+
+ManifestReader::ManifestReader(const char* _path) :
+			path(_path),
+			mapping(nullptr),
+			mappingSize(0)
+{
+	descriptor = open(path, O_RDONLY | O_CLOEXEC);
+	struct stat status;
+	if(descriptor < 0 || fstat(descriptor, &status) != 0)
+	{
+		std::perror(path);
+		std::exit(EXIT_FAILURE);
+	}
+
+	// an empty file cannot be mapped, and has no filenames anyway, while a pipe or a terminal is read as a stream
+	if(S_ISREG(status.st_mode) && status.st_size > 0)
+	{
+		void* contents = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if(contents != MAP_FAILED)
+		{
+			mapping = (const char*) contents;
+			mappingSize = status.st_size;
+
+			// every page is read once, in order, and never again, so the kernel can read far ahead and drop pages
+			// soon after they have been ingested
+			madvise(contents, mappingSize, MADV_SEQUENTIAL);
+		}
+	}
+}
+
+ManifestReader::~ManifestReader()
+{
+	if(mapping != nullptr)
+	{
+		munmap((void*) mapping, mappingSize);
+	}
+	close(descriptor);
+}
+
+void ManifestReader::ingest(IngestPool& pool, char separator)
+{
+	if(mapping == nullptr)
+	{
+		ingestStream(pool, descriptor, separator);
+		return;
+	}
+
+	const char* rangeStart = mapping;
+	const char* mappingEnd = mapping + mappingSize;
+	while(rangeStart != mappingEnd && !pool.isExpired())
+	{
+		// end the range after the first separator past RANGE_SIZE bytes, so that no filename is cut in two. Only
+		// those bytes are looked at here, and the rest of the range is left to the worker thread to split up
+		const char* rangeEnd = rangeStart + std::min(RANGE_SIZE, (std::size_t) (mappingEnd - rangeStart));
+		if(rangeEnd != mappingEnd && *(rangeEnd - 1) != separator)
+		{
+			const char* next = (const char*) std::memchr(rangeEnd, separator, mappingEnd - rangeEnd);
+			rangeEnd = next != nullptr ? next + 1 : mappingEnd;
+		}
+		pool.submitRange(rangeStart, rangeEnd - rangeStart, separator);
+		rangeStart = rangeEnd;
+	}
+}
@@ -0,0 +1,73 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include "ingestpool.hpp"
+
+#ifndef MANIFESTREADER_H
+#define MANIFESTREADER_H
+
+/*
+ * Reads a saved list of filenames, e.g. from find -print0 or a storage inventory, which may be many gigabytes long.
+ * The file is mapped into memory and cut into ranges which end at a separator, and each range is ingested by one of an
+ * IngestPool's worker threads straight from the mapped pages, so no filename is ever copied before it is ingested.
+ * A file which cannot be mapped, like a pipe, is read through a stream instead, as with ingestStream.
+ */
+class ManifestReader
+{
+	public:
+		/*
+		 * Constructs a ManifestReader object, and opens the file and maps it into memory if possible.
+		 * Halts program if the file cannot be opened.
+		 * @param _path the path of the file
+		 */
+		ManifestReader(const char* _path);
+
+		/*
+		 * Unmaps and closes the file.
+		 */
+		~ManifestReader();
+
+		ManifestReader(const ManifestReader&) = delete;
+		ManifestReader& operator=(const ManifestReader&) = delete;
+
+		/*
+		 * Submits every filename in the file to an IngestPool, until the end of the file, or until the IngestPool's
+		 * time budget runs out. The file must stay mapped, i.e. this ManifestReader must not be destroyed, until
+		 * IngestPool::finish returns.
+		 * Halts program if there is an error reading from the file.
+		 * @param pool the IngestPool to submit the filenames to
+		 * @param separator the character that ends each filename in the file, e.g. '\n' or '\0'
+		 */
+		void ingest(IngestPool& pool, char separator);
+	private:
+		/* the number of bytes in each range handed to a worker thread, give or take the rest of the last filename in it.
+		   Big enough that handing out ranges costs nothing next to ingesting them, and small enough to share the work
+		   evenly between the worker threads */
+		static const std::size_t RANGE_SIZE = 1 << 22;
+
+		const char* path; /* the path of the file */
+		int descriptor; /* the open file */
+		const char* mapping; /* the contents of the file, or nullptr if it is not mapped */
+		std::size_t mappingSize; /* the number of bytes in mapping */
+};
+
+#endif /* MANIFESTREADER_H */
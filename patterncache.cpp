@@ -0,0 +1,245 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "patterncache.hpp"
+#include "ingestpool.hpp"
+#include "dirwalker.hpp"
+
+const char PatternCache::MAGIC[8] = {'P', 'A', 'T', 'C', 'A', 'C', 'H', 'E'};
+
+PatternCache::PatternCache(const char* _path) :
+			path(_path),
+			mapping(nullptr),
+			mappingSize(0)
+{
+	int descriptor = open(path, O_RDONLY | O_CLOEXEC);
+	if(descriptor < 0)
+	{
+		// there is no cache yet, which is no different from an outdated one
+		return;
+	}
+
+	struct stat status;
+	if(fstat(descriptor, &status) == 0 && status.st_size > 0)
+	{
+		void* contents = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if(contents != MAP_FAILED)
+		{
+			mapping = (const char*) contents;
+			mappingSize = status.st_size;
+		}
+	}
+	close(descriptor);
+}
+
+PatternCache::~PatternCache()
+{
+	if(mapping != nullptr)
+	{
+		munmap((void*) mapping, mappingSize);
+	}
+}
+
+void PatternCache::summarize(const char* directory, const char* delimiters, bool recursive, bool relativePaths,
+                             unsigned threadCount, const Summarizer::Layout& layout)
+{
+	// note the time before looking at the directory, so that anything which changes it afterwards is either seen
+	// in its modification time, or the modification time is too close to this one to be trusted
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	struct stat status;
+	if(stat(directory, &status) != 0)
+	{
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+
+	Header header;
+	header.recursive = recursive;
+	header.relativePaths = relativePaths;
+	header.hasDelimiters = delimiters != nullptr;
+	header.delimiters = delimiters != nullptr ? delimiters : "";
+	header.device = status.st_dev;
+	header.inode = status.st_ino;
+	header.modified = status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+	header.saved = now.tv_sec * 1000000000LL + now.tv_nsec;
+
+	// the saved pattern only applies if it was computed from the same directory in the same way
+	std::unique_ptr<Summarizer> cached(new Summarizer(delimiters));
+	const char* cachedNames = nullptr;
+	const char* cachedNamesEnd = nullptr;
+	bool loaded = false;
+	if(mapping != nullptr)
+	{
+		StateReader reader(mapping, mappingSize);
+		Header saved;
+		loaded = readHeader(reader, saved) && saved.recursive == recursive && saved.relativePaths == relativePaths &&
+		         saved.hasDelimiters == header.hasDelimiters && saved.delimiters == header.delimiters &&
+		         saved.device == header.device && saved.inode == header.inode && cached -> deserialize(reader);
+		if(loaded)
+		{
+			// the last name must be terminated too, for the names to be safe to compare in place
+			std::size_t namesLength;
+			cachedNames = reader.readString(namesLength);
+			loaded = cachedNames != nullptr && (namesLength == 0 || cachedNames[namesLength - 1] == '\0');
+			cachedNamesEnd = cachedNames + namesLength;
+
+			// a directory's modification time only covers its own entries, not those of its subdirectories
+			if(loaded && !recursive && saved.modified == header.modified &&
+			   saved.saved - saved.modified >= RACY_NANOSECONDS)
+			{
+				cached -> setLayout(layout);
+				int error = cached -> printSummary();
+				if(error != 0)
+				{
+					errno = error;
+					std::perror(nullptr);
+					std::exit(EXIT_FAILURE);
+				}
+				return;
+			}
+		}
+	}
+	if(!loaded)
+	{
+		cachedNames = nullptr;
+		cachedNamesEnd = nullptr;
+		cached.reset(new Summarizer(delimiters));
+	}
+
+	IngestPool pool(delimiters, threadCount);
+	DirectoryWalker walker(pool, recursive, relativePaths, threadCount);
+	std::vector<std::string> names;
+	walker.listNames(directory, names);
+	std::sort(names.begin(), names.end());
+
+	// walk the saved names and the directory's names in step, both being sorted, so that names only in the directory
+	// are ingested, and names only in the cache are removed from the saved pattern
+	{
+		BlockWriter writer(pool);
+		const char* cachedName = cachedNames;
+		for(auto it = names.cbegin(); it != names.cend(); ++it)
+		{
+			int order = 1;
+			while(cachedName != cachedNamesEnd && (order = std::strcmp(cachedName, it -> c_str())) < 0)
+			{
+				std::size_t length = std::strlen(cachedName);
+				cached -> removeFilename(cachedName, length);
+				cachedName += length + 1;
+			}
+
+			if(order == 0)
+			{
+				cachedName += it -> size() + 1;
+			}
+			else
+			{
+				writer.inputFilename(it -> data(), it -> size());
+			}
+		}
+		while(cachedName != cachedNamesEnd)
+		{
+			std::size_t length = std::strlen(cachedName);
+			cached -> removeFilename(cachedName, length);
+			cachedName += length + 1;
+		}
+	}
+
+	Summarizer& added = pool.finish();
+	cached -> merge(added);
+	cached -> setLayout(layout);
+	int error = cached -> printSummary();
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(nullptr);
+		std::exit(EXIT_FAILURE);
+	}
+	save(header, *cached, names);
+}
+
+bool PatternCache::readHeader(StateReader& reader, Header& header)
+{
+	const char* magic = reader.readBytes(sizeof(MAGIC));
+	if(magic == nullptr || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.readInteger() != VERSION)
+	{
+		return false;
+	}
+
+	std::uint64_t flags = reader.readInteger();
+	header.recursive = flags & 1;
+	header.relativePaths = flags & 2;
+	header.hasDelimiters = flags & 4;
+	std::size_t length;
+	const char* delimiters = reader.readString(length);
+	header.delimiters.assign(delimiters != nullptr ? delimiters : "", delimiters != nullptr ? length : 0);
+	header.device = reader.readInteger();
+	header.inode = reader.readInteger();
+	header.modified = reader.readInteger();
+	header.saved = reader.readInteger();
+	return !reader.hasFailed();
+}
+
+void PatternCache::save(const Header& header, const Summarizer& summarizer, const std::vector<std::string>& names) const
+{
+	std::vector<char> contents;
+	StateWriter writer(contents);
+	writer.writeBytes(MAGIC, sizeof(MAGIC));
+	writer.writeInteger(VERSION);
+	writer.writeInteger(header.recursive | header.relativePaths << 1 | header.hasDelimiters << 2);
+	writer.writeString(header.delimiters.data(), header.delimiters.size());
+	writer.writeInteger(header.device);
+	writer.writeInteger(header.inode);
+	writer.writeInteger(header.modified);
+	writer.writeInteger(header.saved);
+	summarizer.serialize(writer);
+
+	// the names are written as one string of NUL-terminated names, which are compared in place when next loaded
+	std::size_t namesLength = 0;
+	for(auto it = names.cbegin(); it != names.cend(); ++it)
+	{
+		namesLength += it -> size() + 1;
+	}
+	writer.writeInteger(namesLength);
+	for(auto it = names.cbegin(); it != names.cend(); ++it)
+	{
+		writer.writeBytes(it -> c_str(), it -> size() + 1);
+	}
+
+	int error = replaceFile(path, contents.data(), contents.size());
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(path);
+		std::exit(EXIT_FAILURE);
+	}
+}
@@ -0,0 +1,115 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "summarizer.hpp"
+#include "statefile.hpp"
+
+#ifndef PATTERNCACHE_H
+#define PATTERNCACHE_H
+
+/*
+ * A file which keeps the pattern of a directory between runs, along with the sorted names of the directory's entries
+ * that went into it. When the directory has not been modified since the file was saved, the pattern is printed
+ * straight from the file, without listing the directory at all. Otherwise, the directory's entries are compared with
+ * the saved names, and only the names added or removed since are ingested into or removed from the saved pattern.
+ * The file is memory-mapped, so that only the parts that are needed are ever read from disk.
+ */
+class PatternCache
+{
+	public:
+		/*
+		 * Constructs a PatternCache object, and maps the cache file into memory if it exists.
+		 * @param _path the path of the cache file
+		 */
+		PatternCache(const char* _path);
+
+		/*
+		 * Unmaps the cache file.
+		 */
+		~PatternCache();
+
+		PatternCache(const PatternCache&) = delete;
+		PatternCache& operator=(const PatternCache&) = delete;
+
+		/*
+		 * Prints the pattern of the entries in a directory, exactly as DirectoryWalker and IngestPool would find it,
+		 * reusing as much of the cache file as still applies, then saves the pattern to the cache file if it changed.
+		 * Halts program if the directory cannot be read, or the cache file cannot be saved.
+		 * @param directory the directory to summarize
+		 * @param delimiters passed on to the constructor of every Summarizer
+		 * @param recursive whether to include the entries of all subdirectories
+		 * @param relativePaths whether to use each entry's path relative to directory, instead of just its name
+		 * @param threadCount the number of threads to ingest names and read subdirectories on. Must be at least 1
+		 * @param layout how to lay out the printed pattern
+		 */
+		void summarize(const char* directory, const char* delimiters, bool recursive, bool relativePaths,
+		               unsigned threadCount, const Summarizer::Layout& layout);
+	private:
+		/* identifies a cache file, and the version of its format */
+		static const char MAGIC[8];
+		static const unsigned VERSION = 2;
+
+		/* how long before the cache file was saved the directory must have been modified last, to be sure that any
+		   later modification changes the directory's modification time, however coarse the filesystem's clock */
+		static const long long RACY_NANOSECONDS = 1000000000LL;
+
+		/*
+		 * What the directory was like when the cache file was saved, and how it was summarized.
+		 */
+		struct Header
+		{
+			bool recursive; /* whether the entries of subdirectories were included */
+			bool relativePaths; /* whether paths relative to the directory were used instead of names */
+			bool hasDelimiters; /* whether any delimiters were given */
+			std::string delimiters; /* the delimiters, as given */
+			std::uint64_t device; /* the device of the directory */
+			std::uint64_t inode; /* the inode of the directory */
+			long long modified; /* the modification time of the directory, in nanoseconds since the epoch */
+			long long saved; /* when the directory was listed for the cache file, in nanoseconds since the epoch */
+		};
+
+		const char* path; /* the path of the cache file */
+		const char* mapping; /* the contents of the cache file, or NULL if there is none */
+		std::size_t mappingSize; /* the number of bytes in mapping */
+
+		/*
+		 * Reads the header of the cache file.
+		 * @param reader where to read the header from
+		 * @param header set to the header
+		 * @return true if the header was read; false if the cache file is not one, or of another version
+		 */
+		static bool readHeader(StateReader& reader, Header& header);
+
+		/*
+		 * Saves a pattern, and the sorted names that went into it, to the cache file, replacing it atomically.
+		 * Halts program if there is an error in writing.
+		 * @param header describes the directory the pattern is of
+		 * @param summarizer holds the pattern
+		 * @param names the names of the directory's entries, in sorted order
+		 */
+		void save(const Header& header, const Summarizer& summarizer, const std::vector<std::string>& names) const;
+};
+
+#endif /* PATTERNCACHE_H */
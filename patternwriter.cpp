@@ -0,0 +1,194 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cmath>
+#include <cstring>
+#include "patternwriter.hpp"
+
+const char PatternWriter::MAGIC[8] = {'P', 'A', 'T', 'T', 'E', 'R', 'N', 'B'};
+
+PatternWriter::PatternWriter(int _fd, Format _format, bool _counts) :
+			fd(_fd),
+			format(_format),
+			counts(_counts),
+			writer(output),
+			column(0),
+			firstColumn(true),
+			firstChunk(true),
+			error(0)
+{
+	output.reserve(SLICE_SIZE + SLICE_SIZE / 2);
+	if(format == JSON)
+	{
+		append("{\"columns\":[");
+	}
+	else if(format == BINARY)
+	{
+		writer.writeBytes(MAGIC, sizeof(MAGIC));
+		writer.writeInteger(VERSION);
+		writer.writeInteger(counts);
+	}
+}
+
+void PatternWriter::visitColumn(std::size_t index, double uniqueCount, bool approximate)
+{
+	column = index;
+	firstChunk = true;
+	std::uint64_t unique = std::llround(uniqueCount);
+	if(format == JSON)
+	{
+		append(firstColumn ? "{\"index\":" : "]},{\"index\":");
+		appendNumber(index);
+		append(",\"unique\":");
+		appendNumber(unique);
+		append(approximate ? ",\"approximate\":true,\"chunks\":[" : ",\"approximate\":false,\"chunks\":[");
+	}
+	else if(format == NDJSON)
+	{
+		append("{\"column\":");
+		appendNumber(index);
+		append(",\"unique\":");
+		appendNumber(unique);
+		append(approximate ? ",\"approximate\":true}\n" : ",\"approximate\":false}\n");
+	}
+	else
+	{
+		writer.writeInteger(1);
+		writer.writeInteger(index);
+		writer.writeInteger(unique);
+		writer.writeInteger(approximate);
+	}
+	firstColumn = false;
+	flush(false);
+}
+
+void PatternWriter::visitChunk(const uint8_t* bytes, std::size_t length, int width, std::size_t count)
+{
+	if(format == BINARY)
+	{
+		writer.writeInteger(2);
+		writer.writeString(bytes, length);
+		writer.writeInteger(width);
+		if(counts)
+		{
+			writer.writeInteger(count);
+		}
+	}
+	else
+	{
+		if(format == JSON)
+		{
+			append(firstChunk ? "{\"text\":" : ",{\"text\":");
+		}
+		else
+		{
+			append("{\"column\":");
+			appendNumber(column);
+			append(",\"text\":");
+		}
+		appendJsonString(bytes, length);
+		append(",\"width\":");
+		appendNumber(width);
+		if(counts)
+		{
+			append(",\"count\":");
+			appendNumber(count);
+		}
+		append(format == JSON ? "}" : "}\n");
+	}
+	firstChunk = false;
+	flush(false);
+}
+
+int PatternWriter::finish()
+{
+	if(format == JSON)
+	{
+		append(firstColumn ? "]}\n" : "]}]}\n");
+	}
+	else if(format == BINARY)
+	{
+		writer.writeInteger(0);
+	}
+	flush(true);
+	return error;
+}
+
+void PatternWriter::append(const char* s)
+{
+	output.insert(output.end(), s, s + std::strlen(s));
+}
+
+void PatternWriter::appendNumber(std::uint64_t value)
+{
+	char digits[20];
+	std::size_t length = 0;
+	do
+	{
+		digits[length++] = '0' + value % 10;
+		value /= 10;
+	}
+	while(value != 0);
+
+	while(length > 0)
+	{
+		output.push_back(digits[--length]);
+	}
+}
+
+void PatternWriter::appendJsonString(const uint8_t* s, std::size_t n)
+{
+	const char HEX_DIGITS[] = "0123456789abcdef";
+	output.push_back('"');
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		// the substrings are already utf-8, so only quotes, backslashes and control characters need escaping
+		char c = s[i];
+		if(c == '"' || c == '\\')
+		{
+			output.push_back('\\');
+			output.push_back(c);
+		}
+		else if(s[i] < 0x20)
+		{
+			const char escape[] = {'\\', 'u', '0', '0', HEX_DIGITS[s[i] >> 4], HEX_DIGITS[s[i] & 0xF]};
+			output.insert(output.end(), escape, escape + sizeof(escape));
+		}
+		else
+		{
+			output.push_back(c);
+		}
+	}
+	output.push_back('"');
+}
+
+void PatternWriter::flush(bool force)
+{
+	if(output.size() < SLICE_SIZE && !force)
+	{
+		return;
+	}
+	if(error == 0)
+	{
+		error = Summarizer::writeFully(fd, output.data(), output.size());
+	}
+	output.clear();
+}
@@ -0,0 +1,125 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "summarizer.hpp"
+#include "statefile.hpp"
+
+#ifndef PATTERNWRITER_H
+#define PATTERNWRITER_H
+
+/*
+ * Writes the pattern in a machine-readable format instead of the grid printed by Summarizer::printSummary, as it is
+ * passed along by Summarizer::visitPattern. Nothing is sorted, encoded in the user's locale or padded: every substring
+ * is written as utf-8 straight out of the pattern, and the output is written out in slices as it is produced, so that
+ * memory use does not grow with the size of the pattern.
+ *
+ * The formats are:
+ * - JSON: one object, {"columns": [{"index": 0, "unique": 2, "approximate": false, "chunks": [{"text": "a",
+ *   "width": 1}, ...]}, ...]}
+ * - NDJSON: one line per column, {"column": 0, "unique": 2, "approximate": false}, followed by one line per substring
+ *   of the column, {"column": 0, "text": "a", "width": 1}
+ * - binary: the bytes "PATTERNB", then, in the variable-length integers of StateWriter, the format version and whether
+ *   counts are included, then for each column a 1, its index, its number of unique substrings (rounded) and whether it
+ *   is approximate, each followed by a 2, its bytes as a StateWriter string and its width for each substring, then a 0
+ * Each substring also has its count, after its width, if counts were asked for.
+ */
+class PatternWriter : public Summarizer::PatternVisitor
+{
+	public:
+		/* the machine-readable formats */
+		enum Format
+		{
+			JSON,
+			NDJSON,
+			BINARY
+		};
+
+		/*
+		 * Constructs a PatternWriter object, and starts off the output.
+		 * @param _fd the file descriptor to write to, e.g. STDOUT_FILENO
+		 * @param _format the format to write the pattern in
+		 * @param _counts whether to write the number of filenames which have each substring
+		 */
+		PatternWriter(int _fd, Format _format, bool _counts);
+
+		/*
+		 * Writes out the start of a column, ending the one before. See Summarizer::PatternVisitor::visitColumn.
+		 */
+		void visitColumn(std::size_t index, double uniqueCount, bool approximate);
+
+		/*
+		 * Writes out a substring of the column being written. See Summarizer::PatternVisitor::visitChunk.
+		 */
+		void visitChunk(const uint8_t* bytes, std::size_t length, int width, std::size_t count);
+
+		/*
+		 * Ends the output, and writes out whatever has not been written yet.
+		 * @return 0, or the errno value describing why the output could not be written
+		 */
+		int finish();
+	private:
+		/* the number of bytes of output to collect before writing them out */
+		static const std::size_t SLICE_SIZE = 1 << 16;
+
+		/* identifies the binary format, and its version */
+		static const char MAGIC[8];
+		static const unsigned VERSION = 1;
+
+		int fd; /* the file descriptor to write to */
+		Format format; /* the format to write the pattern in */
+		bool counts; /* whether to write the number of filenames which have each substring */
+		std::vector<char> output; /* output which has not been written out yet */
+		StateWriter writer; /* appends the integers and strings of the binary format to output */
+		std::size_t column; /* the index of the column being written */
+		bool firstColumn; /* whether no column has been written yet */
+		bool firstChunk; /* whether no substring of the column being written has been written yet */
+		int error; /* the errno value of the first failure to write, or 0 */
+
+		/*
+		 * Appends a string to the output.
+		 * @param s the string
+		 */
+		void append(const char* s);
+
+		/*
+		 * Appends an integer to the output, in decimal.
+		 * @param value the integer
+		 */
+		void appendNumber(std::uint64_t value);
+
+		/*
+		 * Appends a utf-8 string to the output as a quoted JSON string, escaping the characters JSON requires.
+		 * @param s the bytes of the string
+		 * @param n the number of bytes in s
+		 */
+		void appendJsonString(const uint8_t* s, std::size_t n);
+
+		/*
+		 * Writes out the output collected so far once there is enough of it, unless writing has already failed.
+		 * @param force whether to write it out however little there is
+		 */
+		void flush(bool force);
+};
+
+#endif /* PATTERNWRITER_H */
@@ -0,0 +1,207 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <algorithm>
+#include <cstring>
+#include "prefixtrie.hpp"
+
+const std::uint32_t PrefixTrie::ROOT;
+
+void PrefixTrie::findMarks(const std::uint8_t* s, std::size_t n, std::vector<Match>& matches) const
+{
+	matches.clear();
+	std::uint32_t node = ROOT;
+	std::size_t length = 0;
+	while(length < n)
+	{
+		node = findChild(node, s[length]);
+		if(node == NONE)
+		{
+			return;
+		}
+
+		// the first byte of the label is the one the child was found by
+		const Node& child = nodes[node];
+		if(child.labelLength > n - length ||
+		   std::memcmp(&labels[child.labelStart + 1], s + length + 1, child.labelLength - 1) != 0)
+		{
+			return;
+		}
+		length += child.labelLength;
+		if(child.mark != NO_MARK)
+		{
+			Match match;
+			match.node = node;
+			match.length = length;
+			match.mark = (Mark) child.mark;
+			match.ascii = child.ascii;
+			matches.push_back(match);
+		}
+	}
+}
+
+void PrefixTrie::getChunks(std::uint32_t node, std::vector<std::uint32_t>& chunks) const
+{
+	std::size_t count = 0;
+	for(std::uint32_t mark = node; mark != ROOT; mark = nodes[mark].previousMark)
+	{
+		count += nodes[mark].chunkCount;
+	}
+
+	// the chunks since each mark are filled in from the last mark back to the first
+	chunks.resize(count);
+	for(std::uint32_t mark = node; mark != ROOT; mark = nodes[mark].previousMark)
+	{
+		const Node& marked = nodes[mark];
+		count -= marked.chunkCount;
+		std::copy(this -> chunks.begin() + marked.firstChunk,
+		          this -> chunks.begin() + marked.firstChunk + marked.chunkCount, chunks.begin() + count);
+	}
+}
+
+void PrefixTrie::addMarks(const std::uint8_t* s, std::uint32_t node, std::size_t length,
+                          const std::vector<NewMark>& marks, const std::vector<std::uint32_t>& chunkIndices)
+{
+	std::uint32_t previousMark = node;
+	std::size_t chunkStart = 0;
+	for(auto it = marks.cbegin(); it != marks.cend(); ++it)
+	{
+		// follow the path of the filename down to the end of the prefix, adding whatever is missing from it
+		while(length < it -> length)
+		{
+			std::uint32_t child = findChild(node, s[length]);
+			if(child == NONE)
+			{
+				node = addChild(node, s + length, it -> length - length);
+				length = it -> length;
+				break;
+			}
+
+			std::size_t common = 1;
+			std::size_t limit = std::min<std::size_t>(nodes[child].labelLength, it -> length - length);
+			while(common < limit && labels[nodes[child].labelStart + common] == s[length + common])
+			{
+				++common;
+			}
+			if(common < nodes[child].labelLength)
+			{
+				child = splitLabel(node, child, common);
+			}
+			node = child;
+			length += common;
+		}
+
+		// a prefix which was marked before has the same chunks; one which ends a filename might also be a boundary
+		// between chunks whatever follows it
+		Node& marked = nodes[node];
+		if(marked.mark == NO_MARK)
+		{
+			marked.mark = it -> mark;
+			marked.ascii = it -> ascii;
+			marked.previousMark = previousMark;
+			marked.firstChunk = chunks.size();
+			marked.chunkCount = it -> chunkEnd - chunkStart;
+			chunks.insert(chunks.end(), chunkIndices.begin() + chunkStart, chunkIndices.begin() + it -> chunkEnd);
+		}
+		else if(it -> mark == SPLIT_MARK)
+		{
+			marked.mark = SPLIT_MARK;
+		}
+		previousMark = node;
+		chunkStart = it -> chunkEnd;
+	}
+}
+
+void PrefixTrie::clear()
+{
+	nodes.assign(1, Node());
+	nodes[ROOT].mark = NO_MARK;
+	labels.clear();
+	chunks.clear();
+	edges.assign(MIN_SLOTS, Edge());
+	edgeCount = 0;
+}
+
+std::size_t PrefixTrie::findEdge(std::uint32_t node, std::uint8_t byte) const
+{
+	std::uint64_t key = ((std::uint64_t) node << 8 | byte) + 1;
+	std::size_t mask = edges.size() - 1;
+	std::size_t position = (key * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+	while(edges[position].key != 0 && edges[position].key != key)
+	{
+		position = (position + 1) & mask;
+	}
+	return position;
+}
+
+void PrefixTrie::addEdge(std::uint32_t node, std::uint8_t byte, std::uint32_t child)
+{
+	if(2 * (edgeCount + 1) > edges.size())
+	{
+		std::vector<Edge> old(2 * edges.size());
+		old.swap(edges);
+		for(auto it = old.cbegin(); it != old.cend(); ++it)
+		{
+			if(it -> key != 0)
+			{
+				std::uint64_t key = it -> key - 1;
+				edges[findEdge(key >> 8, key & 0xFF)] = *it;
+			}
+		}
+	}
+
+	Edge& edge = edges[findEdge(node, byte)];
+	edge.key = ((std::uint64_t) node << 8 | byte) + 1;
+	edge.child = child;
+	++edgeCount;
+}
+
+std::uint32_t PrefixTrie::addChild(std::uint32_t parent, const std::uint8_t* s, std::size_t n)
+{
+	std::uint32_t child = nodes.size();
+	Node node = Node();
+	node.labelStart = labels.size();
+	node.labelLength = n;
+	node.previousMark = ROOT;
+	node.mark = NO_MARK;
+	labels.insert(labels.end(), s, s + n);
+	nodes.push_back(node);
+	addEdge(parent, s[0], child);
+	return child;
+}
+
+std::uint32_t PrefixTrie::splitLabel(std::uint32_t parent, std::uint32_t child, std::size_t length)
+{
+	std::uint32_t head = nodes.size();
+	Node middle = Node();
+	middle.labelStart = nodes[child].labelStart;
+	middle.labelLength = length;
+	middle.previousMark = ROOT;
+	middle.mark = NO_MARK;
+
+	// the new node takes the child's place as the parent's child, and the child hangs off the new node
+	edges[findEdge(parent, labels[middle.labelStart])].child = head;
+	nodes[child].labelStart += length;
+	nodes[child].labelLength -= length;
+	nodes.push_back(middle);
+	addEdge(head, labels[nodes[child].labelStart], child);
+	return head;
+}
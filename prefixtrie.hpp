@@ -0,0 +1,204 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef PREFIXTRIE_H
+#define PREFIXTRIE_H
+
+/*
+ * A radix trie of the raw bytes of filenames, which remembers the chunks that the filenames were split into at points
+ * where a filename can be cut in two without changing how its first part is split, so that the chunks of a shared
+ * prefix are only computed once. Each such point is a mark on a node of the trie, which holds the chunks found since
+ * the previous mark along the way from the root; all of a prefix's chunks are found by following its marks back to the
+ * root. A chunk is held as its index in its column, whose position is its position in the prefix.
+ *
+ * Nodes are kept in one vector and their labels in one byte pool, and the edges to every node's children in one
+ * open-addressing hash table keyed by the node and the first byte of the child's label, so that going down a level of
+ * the trie costs one probe, and a trie is a handful of allocations however many filenames it holds. Once it holds more
+ * than a fixed number of nodes or bytes, few enough for the trie to stay in the cache, no more marks are added, but
+ * the marks already in it are still found.
+ */
+class PrefixTrie
+{
+	public:
+		/* what a mark says about the prefix which ends at it */
+		enum Mark
+		{
+			NO_MARK, /* nothing: the node only joins its parent's label to its children's */
+			END_MARK, /* a filename consisting of just the prefix was split into the mark's chunks */
+			SPLIT_MARK /* a filename starting with the prefix was split into the mark's chunks up to the end of the
+			              prefix, which is a boundary between chunks whatever follows it */
+		};
+
+		/*
+		 * A mark on the path of a filename through the trie, as found by PrefixTrie::findMarks.
+		 */
+		struct Match
+		{
+			std::uint32_t node; /* the node with the mark */
+			std::size_t length; /* the number of bytes in the prefix which ends at the mark */
+			Mark mark; /* the kind of mark */
+			bool ascii; /* whether the prefix consists only of printable ASCII characters */
+		};
+
+		/*
+		 * A mark to add along the path of a filename with PrefixTrie::addMarks.
+		 */
+		struct NewMark
+		{
+			std::size_t length; /* the number of bytes in the prefix which ends at the mark */
+			Mark mark; /* the kind of mark, which must not be NO_MARK */
+			std::size_t chunkEnd; /* the end of the mark's chunks in the chunk indices passed to PrefixTrie::addMarks */
+			bool ascii; /* whether the prefix consists only of printable ASCII characters */
+		};
+
+		/* the node at the root of the trie, which is where an empty prefix ends */
+		static const std::uint32_t ROOT = 0;
+
+		/*
+		 * Constructs an empty PrefixTrie object.
+		 */
+		PrefixTrie() { clear(); }
+
+		/*
+		 * Finds every mark on the path of a filename through the trie, i.e. every marked prefix of the filename.
+		 * @param s the bytes of the filename
+		 * @param n the number of bytes in the filename
+		 * @param matches set to the marks, from the shortest prefix to the longest
+		 */
+		void findMarks(const std::uint8_t* s, std::size_t n, std::vector<Match>& matches) const;
+
+		/*
+		 * @param node a node with a mark, or ROOT
+		 * @param chunks set to the column indices of every chunk of the prefix which ends at the node, in order
+		 */
+		void getChunks(std::uint32_t node, std::vector<std::uint32_t>& chunks) const;
+
+		/*
+		 * Adds marks along the path of a filename, after a prefix of it which already ends at a node.
+		 * @param s the bytes of the filename, up to at least the last new mark
+		 * @param node the node where the prefix ends, which has a mark or is ROOT
+		 * @param length the number of bytes in the prefix
+		 * @param marks the new marks, from the shortest prefix to the longest, all longer than length
+		 * @param chunkIndices the column indices of the filename's chunks after the prefix, in order; each mark holds
+		 *        the ones from the previous mark's chunkEnd (or from the first) up to its own
+		 */
+		void addMarks(const std::uint8_t* s, std::uint32_t node, std::size_t length, const std::vector<NewMark>& marks,
+		              const std::vector<std::uint32_t>& chunkIndices);
+
+		/*
+		 * @return whether the trie is too big for any more marks to be added
+		 */
+		bool isFull() const { return nodes.size() > MAX_NODES || labels.size() > MAX_BYTES || chunks.size() > MAX_BYTES; }
+
+		/*
+		 * Forgets every mark, e.g. once the chunks they hold may have moved to other indices in their columns.
+		 */
+		void clear();
+	private:
+		/* the most nodes, and the most label bytes or chunk indices, that marks are added to a trie with */
+		static const std::size_t MAX_NODES = 1 << 14;
+		static const std::size_t MAX_BYTES = 1 << 19;
+
+		/* the smallest number of slots in the hash table of edges */
+		static const std::size_t MIN_SLOTS = 16;
+
+		/* marks the lack of a child */
+		static const std::uint32_t NONE = UINT32_MAX;
+
+		struct Node
+		{
+			std::uint32_t labelStart; /* where the bytes leading from the node's parent to the node begin in labels */
+			std::uint32_t labelLength; /* the number of bytes leading from the node's parent to the node */
+			std::uint32_t previousMark; /* the closest node with a mark on the way to the node, or ROOT */
+			std::uint32_t firstChunk; /* where the chunks since previousMark begin in chunks */
+			std::uint32_t chunkCount; /* the number of chunks since previousMark */
+			std::uint8_t mark; /* the node's Mark */
+			bool ascii; /* whether the prefix which ends at the node consists only of printable ASCII characters */
+		};
+
+		/*
+		 * A slot of the hash table of edges.
+		 */
+		struct Edge
+		{
+			std::uint64_t key; /* 1 + the parent node times 256 + the first byte of the child's label, or 0 if empty */
+			std::uint32_t child; /* the child node */
+		};
+
+		std::vector<Node> nodes; /* every node in the trie, starting with ROOT */
+		std::vector<std::uint8_t> labels; /* the bytes of every node's label */
+		std::vector<std::uint32_t> chunks; /* the column indices of the chunks held by every mark */
+		std::vector<Edge> edges; /* the hash table of the edges from every node to its children */
+		std::size_t edgeCount; /* the number of edges in the hash table */
+
+		/*
+		 * @param node a node of the trie
+		 * @param byte the first byte of a label
+		 * @return the slot of the edge from the node to its child whose label starts with the byte, or the empty slot
+		 *         it would go in
+		 */
+		std::size_t findEdge(std::uint32_t node, std::uint8_t byte) const;
+
+		/*
+		 * @param node a node of the trie
+		 * @param byte the first byte of a label
+		 * @return the child of the node whose label starts with the byte, or NONE
+		 */
+		std::uint32_t findChild(std::uint32_t node, std::uint8_t byte) const
+		{
+			const Edge& edge = edges[findEdge(node, byte)];
+			return edge.key != 0 ? edge.child : NONE;
+		}
+
+		/*
+		 * Adds an edge from a node to a child with no edge from the node yet for the first byte of its label, growing
+		 * the hash table first if it is half full.
+		 * @param node the parent node
+		 * @param byte the first byte of the child's label
+		 * @param child the child node
+		 */
+		void addEdge(std::uint32_t node, std::uint8_t byte, std::uint32_t child);
+
+		/*
+		 * Adds a new node as a child of another, with a label copied into labels.
+		 * @param parent the node to add a child to
+		 * @param s the bytes of the label
+		 * @param n the number of bytes in the label, at least 1
+		 * @return the new node
+		 */
+		std::uint32_t addChild(std::uint32_t parent, const std::uint8_t* s, std::size_t n);
+
+		/*
+		 * Cuts the label of a node in two, with a new node in between, so that a prefix can end partway through it.
+		 * The node keeps its index, so that later marks can still refer to it.
+		 * @param parent the parent of the node
+		 * @param child the node
+		 * @param length the number of bytes of the label which lead to the new node, from 1 to the label's length - 1
+		 * @return the new node, which takes the node's place as a child of the parent
+		 */
+		std::uint32_t splitLabel(std::uint32_t parent, std::uint32_t child, std::size_t length);
+};
+
+#endif /* PREFIXTRIE_H */
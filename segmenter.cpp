@@ -0,0 +1,195 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <unigbrk.h>
+#include <uniwidth.h>
+#include "segmenter.hpp"
+#include "unicodetables.hpp"
+
+/*
+ * @param c a code point
+ * @return the properties of c, as laid out by CodePointProperty
+ */
+static inline std::uint8_t lookUp(std::uint32_t c)
+{
+	return UNICODE_PROPERTIES[((std::size_t) UNICODE_BLOCKS[c >> UNICODE_BLOCK_SHIFT] << UNICODE_BLOCK_SHIFT) |
+	                          (c & ((1u << UNICODE_BLOCK_SHIFT) - 1))];
+}
+
+/*
+ * @param c a code point
+ * @return the canonical combining class of c, or NFC_NOT_QUICK
+ */
+static inline std::uint8_t lookUpNfcClass(std::uint32_t c)
+{
+	return NFC_CLASSES[((std::size_t) NFC_BLOCKS[c >> NFC_BLOCK_SHIFT] << NFC_BLOCK_SHIFT) |
+	                   (c & ((1u << NFC_BLOCK_SHIFT) - 1))];
+}
+
+/*
+ * Decodes the code point at the start of a utf-8 string, like libunistring's u8_mbtouc.
+ * @param s the string
+ * @param n the number of bytes in s, at least 1
+ * @param c out: the code point, or U+FFFD if s does not begin with a valid one
+ * @return the number of bytes that the code point takes up, or 1 if it is not valid
+ */
+static inline int decode(const std::uint8_t* s, std::size_t n, std::uint32_t& c)
+{
+	std::uint8_t lead = s[0];
+	if(lead < 0x80)
+	{
+		c = lead;
+		return 1;
+	}
+
+	int length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+	std::uint32_t minimum = length == 4 ? 0x10000 : length == 3 ? 0x800 : 0x80;
+	c = 0xFFFD;
+	if(lead < 0xC2 || lead > 0xF4 || n < (std::size_t) length)
+	{
+		return 1;
+	}
+	std::uint32_t result = lead & (0x7F >> length);
+	for(int i = 1; i < length; ++i)
+	{
+		if((s[i] & 0xC0) != 0x80)
+		{
+			return 1;
+		}
+		result = (result << 6) | (s[i] & 0x3F);
+	}
+	if(result < minimum || result > 0x10FFFF || (result >= 0xD800 && result < 0xE000))
+	{
+		return 1;
+	}
+	c = result;
+	return length;
+}
+
+void segmentGraphemes(const std::uint8_t* s, std::size_t n, char* breaks, int* widths, bool cjkWidths)
+{
+	int width = 0;
+	int previous = GBP_CONTROL; // so that the first code point begins a grapheme cluster
+	bool inEmoji = false; // whether the code points so far end in an Extended_Pictographic one, then any Extend ones
+	bool afterEmojiJoiner = false;
+	bool oddRegionalIndicators = false;
+	for(std::size_t i = 0; i < n;)
+	{
+		std::uint32_t c;
+		int length = decode(s + i, n - i, c);
+		std::uint8_t property = lookUp(c);
+		int next = property & GRAPHEME_BREAK_MASK;
+		bool pictographic = property & EXTENDED_PICTOGRAPHIC_BIT;
+
+		switch(GRAPHEME_BREAK_RULES[previous * (GRAPHEME_BREAK_MASK + 1) + next])
+		{
+			case NO_BREAK:
+				breaks[i] = 0;
+				break;
+			case BREAK:
+				breaks[i] = 1;
+				break;
+			case BREAK_UNLESS_EMOJI:
+				breaks[i] = !(afterEmojiJoiner && pictographic);
+				break;
+			case BREAK_UNLESS_ODD_REGIONAL:
+				breaks[i] = !oddRegionalIndicators;
+				break;
+		}
+		for(int j = 1; j < length; ++j)
+		{
+			breaks[i + j] = 0;
+		}
+
+		// like u8_width, count control characters as 0 columns wide
+		widths[i] = width;
+		int codePointWidth = (property & WIDTH_MASK) >> WIDTH_SHIFT;
+		if(cjkWidths && (property & CJK_WIDE_BIT))
+		{
+			codePointWidth = 2;
+		}
+		width += codePointWidth == CONTROL_WIDTH ? 0 : codePointWidth;
+
+		afterEmojiJoiner = next == GBP_ZWJ && inEmoji;
+		inEmoji = pictographic || (inEmoji && next == GBP_EXTEND);
+		oddRegionalIndicators = next == GBP_RI && !oddRegionalIndicators;
+		previous = next;
+		i += length;
+	}
+	widths[n] = width;
+}
+
+bool isQuickNfc(const std::uint8_t* s, std::size_t n)
+{
+	std::uint8_t previousClass = 0;
+	for(std::size_t i = 0; i < n;)
+	{
+		if(s[i] < 0x80)
+		{
+			// every ASCII character is a starter which nothing composes with
+			previousClass = 0;
+			++i;
+			continue;
+		}
+
+		std::uint32_t c;
+		int length = decode(s + i, n - i, c);
+		std::uint8_t combiningClass = lookUpNfcClass(c);
+		if(length == 1 || combiningClass == NFC_NOT_QUICK || (combiningClass != 0 && previousClass > combiningClass))
+		{
+			return false;
+		}
+		previousClass = combiningClass;
+		i += length;
+	}
+	return true;
+}
+
+bool isIndependentSplit(const std::uint8_t* s, std::size_t n, std::size_t split)
+{
+	// the code point before the split starts at its last byte which is not a continuation byte
+	std::size_t start = split - 1;
+	while(start > 0 && split - start < 4 && (s[start] & 0xC0) == 0x80)
+	{
+		--start;
+	}
+
+	std::uint32_t before;
+	std::uint32_t after;
+	int beforeLength = decode(s + start, split - start, before);
+	int afterLength = decode(s + split, n - split, after);
+	if(beforeLength != (int) (split - start) || (beforeLength == 1 && s[start] >= 0x80) ||
+	   (afterLength == 1 && s[split] >= 0x80))
+	{
+		return false;
+	}
+
+	std::uint8_t combiningClass = lookUpNfcClass(after);
+	int previous = lookUp(before) & GRAPHEME_BREAK_MASK;
+	int next = lookUp(after) & GRAPHEME_BREAK_MASK;
+	return combiningClass == 0 && GRAPHEME_BREAK_RULES[previous * (GRAPHEME_BREAK_MASK + 1) + next] == BREAK;
+}
+
+bool usesCjkWidths(const char* encoding)
+{
+	// U+00A1 INVERTED EXCLAMATION MARK is one of the characters which are only wide in CJK encodings
+	return uc_width(0x00A1, encoding) == 2;
+}
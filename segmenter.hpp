@@ -0,0 +1,108 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+/*
+ * The properties of a code point, as looked up by segmentGraphemes in the tables generated by gentables. Each is a byte
+ * made up of these fields.
+ */
+enum CodePointProperty
+{
+	GRAPHEME_BREAK_MASK = 0x0F, /* the code point's Grapheme_Cluster_Break property, as one of libunistring's GBP_ values */
+	EXTENDED_PICTOGRAPHIC_BIT = 0x10, /* set if the code point has the Extended_Pictographic property */
+	WIDTH_SHIFT = 5, /* where the code point's display width is kept, from 0 to 2, or CONTROL_WIDTH for a control */
+	WIDTH_MASK = 0x60,
+	CONTROL_WIDTH = 3,
+	CJK_WIDE_BIT = 0x80 /* set if the code point is 2 columns wide in CJK encodings, though 1 column wide otherwise */
+};
+
+/*
+ * Whether there is a grapheme cluster boundary between two code points, as far as can be told from their grapheme
+ * cluster break properties, which index the GRAPHEME_BREAK_RULES table generated by gentables.
+ */
+enum GraphemeBreakRule
+{
+	NO_BREAK,
+	BREAK,
+	BREAK_UNLESS_EMOJI, /* no boundary if the code points before it are an Extended_Pictographic one, any number of
+	                       Extend ones, then a ZWJ, and the code point after it is Extended_Pictographic */
+	BREAK_UNLESS_ODD_REGIONAL /* no boundary if the code points before it end in an odd number of Regional_Indicator ones */
+};
+
+/*
+ * Finds the boundaries between the grapheme clusters of a utf-8 string, with exactly the same result as libunistring's
+ * u8_grapheme_breaks, and in the same pass over the string, its display width up to each code point, with exactly the
+ * same result as libunistring's u8_width (which stops at a NUL character, unlike this function). Each code point's
+ * properties are found with two lookups into tables that gentables generates from libunistring when building, instead
+ * of libunistring's generic property lookups, and the boundary between two code points with one more lookup.
+ * @param s the string to segment, which should be valid utf-8. Does not need to be NUL-terminated
+ * @param n the number of bytes in s
+ * @param breaks n bytes to write the boundaries to: breaks[i] is set to 1 if a grapheme cluster begins at s[i], or
+ *        else 0
+ * @param widths n + 1 ints to write the widths to: widths[i] is set to the display width of the first i bytes of s,
+ *        for each i at which a code point begins, and for n. The other elements are left as they were
+ * @param cjkWidths whether characters which are wide in CJK encodings count as 2 columns wide, as u8_width counts them
+ *        when given one of those encodings; see usesCjkWidths
+ */
+void segmentGraphemes(const std::uint8_t* s, std::size_t n, char* breaks, int* widths, bool cjkWidths);
+
+/* the value of a code point in the NFC_CLASSES table generated by gentables, if its NFC_Quick_Check property is not
+   "Yes"; otherwise the value is its canonical combining class */
+const std::uint8_t NFC_NOT_QUICK = 0xFF;
+
+/*
+ * Checks whether a utf-8 string is certainly in Normalization Form C without normalizing it, by the quick check of
+ * https://unicode.org/reports/tr15/#Detecting_Normalization_Forms : every code point must have the NFC_Quick_Check
+ * property "Yes", and the combining marks must be in canonical order. Each code point is looked up in a two-level
+ * table that gentables generates from libunistring when building.
+ * @param s the string to check. Does not need to be NUL-terminated
+ * @param n the number of bytes in s
+ * @return true if normalizing s with u8_normalize(UNINORM_NFC, ...) would leave it unchanged; false if it might
+ *         change s, or s is not valid utf-8
+ */
+bool isQuickNfc(const std::uint8_t* s, std::size_t n);
+
+/*
+ * Checks whether a utf-8 string can be split in two at a given point, such that normalizing each part to NFC and
+ * finding each part's grapheme clusters on its own gives the same result as for the whole string. That is the case if
+ * the code point after the split is a starter which nothing composes with, i.e. has the NFC_Quick_Check property
+ * "Yes" and combining class 0, and the grapheme cluster break rules always break between the code points on either
+ * side of it, since the rules only ever look back from a boundary.
+ * @param s the string. Does not need to be NUL-terminated
+ * @param n the number of bytes in s
+ * @param split the number of bytes before the split, from 1 to n - 1
+ * @return true if the string can be split there; false if it may not, or the code points on either side of the split
+ *         are not valid utf-8
+ */
+bool isIndependentSplit(const std::uint8_t* s, std::size_t n, std::size_t split);
+
+/*
+ * @param encoding libunistring-recognized code for an encoding, e.g. the user's locale's
+ * @return whether u8_width counts the code points marked CJK_WIDE_BIT as 2 columns wide in the encoding
+ */
+bool usesCjkWidths(const char* encoding);
+
+#endif /* SEGMENTER_H */
@@ -0,0 +1,152 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <string>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "statefile.hpp"
+
+/*
+ * Closes and deletes a temporary file which could not be written, keeping errno as it was.
+ * @param path the path of the temporary file
+ * @param descriptor the open temporary file, or -1 if it is closed already
+ * @return the errno value describing why the file could not be written
+ */
+static int abandonFile(const char* path, int descriptor)
+{
+	int error = errno;
+	if(descriptor >= 0)
+	{
+		close(descriptor);
+	}
+	unlink(path);
+	return error;
+}
+
+void StateWriter::writeInteger(std::uint64_t value)
+{
+	while(value >= 0x80)
+	{
+		buffer.push_back((char) (0x80 | (value & 0x7F)));
+		value >>= 7;
+	}
+	buffer.push_back((char) value);
+}
+
+void StateWriter::writeBytes(const void* data, std::size_t n)
+{
+	buffer.insert(buffer.end(), (const char*) data, (const char*) data + n);
+}
+
+void StateWriter::writeString(const void* data, std::size_t n)
+{
+	writeInteger(n);
+	writeBytes(data, n);
+}
+
+std::uint64_t StateReader::readInteger()
+{
+	std::uint64_t value = 0;
+	for(unsigned shift = 0; !failed; shift += 7)
+	{
+		if(position == end || shift > 63)
+		{
+			failed = true;
+			break;
+		}
+
+		unsigned char byte = *position++;
+		value |= (std::uint64_t) (byte & 0x7F) << shift;
+		if((byte & 0x80) == 0)
+		{
+			return value;
+		}
+	}
+	return 0;
+}
+
+const char* StateReader::readBytes(std::size_t n)
+{
+	if(failed || n > remaining())
+	{
+		failed = true;
+		return nullptr;
+	}
+
+	const char* bytes = position;
+	position += n;
+	return bytes;
+}
+
+const char* StateReader::readString(std::size_t& n)
+{
+	n = readInteger();
+	return readBytes(n);
+}
+
+int replaceFile(const char* path, const char* data, std::size_t size)
+{
+	// a temporary file of its own, so that overlapping runs writing the same file never write into each other's
+	std::string temporaryPath(path);
+	temporaryPath += ".XXXXXX";
+	int descriptor = mkostemp(&temporaryPath[0], O_CLOEXEC);
+	if(descriptor < 0)
+	{
+		return errno;
+	}
+
+	// the file being replaced keeps its permissions, while a new one is only readable by its owner, like any
+	// other temporary file made by mkostemp
+	struct stat status;
+	if(stat(path, &status) == 0 && fchmod(descriptor, status.st_mode & 07777) != 0)
+	{
+		return abandonFile(temporaryPath.c_str(), descriptor);
+	}
+
+	while(size > 0)
+	{
+		ssize_t written = write(descriptor, data, size);
+		if(written < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return abandonFile(temporaryPath.c_str(), descriptor);
+		}
+		data += written;
+		size -= written;
+	}
+
+	// the contents must be on disk before the rename is, or a crash could leave an empty file in place of the old one
+	if(fsync(descriptor) != 0)
+	{
+		return abandonFile(temporaryPath.c_str(), descriptor);
+	}
+	if(close(descriptor) != 0 || rename(temporaryPath.c_str(), path) != 0)
+	{
+		return abandonFile(temporaryPath.c_str(), -1);
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef STATEFILE_H
+#define STATEFILE_H
+
+/*
+ * Appends values to a buffer in the compact binary format used for saved pattern state. Integers are written as
+ * variable-length quantities, 7 bits to a byte with the lowest bits first, so that the small numbers which make up most
+ * of a pattern (lengths, widths, counts) take a byte or two each, regardless of the machine's byte order.
+ */
+class StateWriter
+{
+	public:
+		/*
+		 * Constructs a StateWriter object.
+		 * @param _buffer the buffer to append values to
+		 */
+		StateWriter(std::vector<char>& _buffer) : buffer(_buffer) {}
+
+		/*
+		 * Appends an unsigned integer.
+		 * @param value the integer
+		 */
+		void writeInteger(std::uint64_t value);
+
+		/*
+		 * Appends bytes as they are, without their length.
+		 * @param data the bytes
+		 * @param n the number of bytes
+		 */
+		void writeBytes(const void* data, std::size_t n);
+
+		/*
+		 * Appends the length of a string of bytes, followed by the bytes.
+		 * @param data the bytes
+		 * @param n the number of bytes
+		 */
+		void writeString(const void* data, std::size_t n);
+	private:
+		std::vector<char>& buffer; /* the buffer being appended to */
+};
+
+/*
+ * Reads values written by a StateWriter out of a buffer, e.g. a memory-mapped file, without copying it. Reading past
+ * the end of the buffer, or a malformed integer, marks the reader as failed instead of halting the program, since a
+ * saved state may have been truncated or overwritten.
+ */
+class StateReader
+{
+	public:
+		/*
+		 * Constructs a StateReader object.
+		 * @param data the buffer to read values from. Must outlive the StateReader, and any bytes read from it
+		 * @param size the number of bytes in data
+		 */
+		StateReader(const char* data, std::size_t size) : position(data), end(data + size), failed(false) {}
+
+		/*
+		 * Reads an unsigned integer.
+		 * @return the integer, or 0 if the reader has failed
+		 */
+		std::uint64_t readInteger();
+
+		/*
+		 * Reads bytes written by StateWriter::writeBytes.
+		 * @param n the number of bytes
+		 * @return a pointer to the bytes inside the buffer, or NULL if the reader has failed
+		 */
+		const char* readBytes(std::size_t n);
+
+		/*
+		 * Reads a string of bytes written by StateWriter::writeString.
+		 * @param n set to the number of bytes in the string
+		 * @return a pointer to the bytes inside the buffer, or NULL if the reader has failed
+		 */
+		const char* readString(std::size_t& n);
+
+		/*
+		 * @return the number of bytes left to read
+		 */
+		std::size_t remaining() const { return end - position; }
+
+		/*
+		 * @return whether anything could not be read, in which case nothing more will be
+		 */
+		bool hasFailed() const { return failed; }
+	private:
+		const char* position; /* the next byte to read */
+		const char* end; /* the end of the buffer */
+		bool failed; /* set once anything could not be read */
+};
+
+/*
+ * Replaces a file with the contents of a buffer, by writing them to a new temporary file next to it first, flushing
+ * that to disk and renaming it over the file, so that the file is never seen half-written, even when several processes
+ * replace it at once. The file keeps its permissions, or if it is new, is only readable and writable by its owner.
+ * @param path the path of the file
+ * @param data the new contents of the file
+ * @param size the number of bytes in data
+ * @return 0, or the errno value describing why the file could not be written
+ */
+int replaceFile(const char* path, const char* data, std::size_t size);
+
+#endif /* STATEFILE_H */
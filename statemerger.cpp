@@ -0,0 +1,145 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "statemerger.hpp"
+#include "ingestpool.hpp"
+#include "statefile.hpp"
+
+const char StateMerger::MAGIC[8] = {'P', 'A', 'T', 'S', 'T', 'A', 'T', 'E'};
+
+StateMerger::StateMerger(const char* const* _paths, std::size_t _count, const char* delimiters,
+                         const Summarizer::Options& options, unsigned _threadCount) :
+			paths(_paths),
+			count(_count),
+			threadCount(_threadCount),
+			errors(_count, 0)
+{
+	// the Summarizers are all constructed up front, before any thread starts loading state files into them
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		states.emplace_back(new Summarizer(delimiters, options));
+	}
+}
+
+Summarizer& StateMerger::merge()
+{
+	std::vector<std::thread> loaders;
+	for(std::size_t i = 0; i < threadCount && i < count; ++i)
+	{
+		loaders.emplace_back(&StateMerger::load, this, i);
+	}
+	for(auto it = loaders.begin(); it != loaders.end(); ++it)
+	{
+		it -> join();
+	}
+
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		if(errors[i] > 0)
+		{
+			errno = errors[i];
+			std::perror(paths[i]);
+			std::exit(EXIT_FAILURE);
+		}
+		if(errors[i] < 0)
+		{
+			std::fprintf(stderr, "%s: not a state file saved in this locale with the same delimiters and options\n",
+			             paths[i]);
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	std::vector<Summarizer*> shards;
+	for(auto it = states.begin(); it != states.end(); ++it)
+	{
+		shards.push_back(it -> get());
+	}
+	{
+		StageTimer timer(states.front() -> getStats(), Stats::MERGE);
+		IngestPool::mergeTree(shards);
+	}
+	return *states.front();
+}
+
+void StateMerger::save(const Summarizer& summarizer, const char* path)
+{
+	std::vector<char> contents;
+	StateWriter writer(contents);
+	writer.writeBytes(MAGIC, sizeof(MAGIC));
+	writer.writeInteger(VERSION);
+	summarizer.serialize(writer);
+
+	int error = replaceFile(path, contents.data(), contents.size());
+	if(error != 0)
+	{
+		errno = error;
+		std::perror(path);
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+void StateMerger::load(std::size_t first)
+{
+	for(std::size_t i = first; i < count; i += threadCount)
+	{
+		int descriptor = open(paths[i], O_RDONLY | O_CLOEXEC);
+		struct stat status;
+		if(descriptor < 0 || fstat(descriptor, &status) != 0)
+		{
+			errors[i] = errno;
+			if(descriptor >= 0)
+			{
+				close(descriptor);
+			}
+			continue;
+		}
+
+		void* contents = status.st_size > 0 ? mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0)
+		                                    : MAP_FAILED;
+		int mapError = errno;
+		close(descriptor);
+		if(contents == MAP_FAILED)
+		{
+			// an empty file cannot be mapped, but is no state file either
+			errors[i] = status.st_size > 0 ? mapError : -1;
+			continue;
+		}
+
+		// the pattern is copied out of the mapping as it is restored, so the mapping is only needed until then
+		StateReader reader((const char*) contents, status.st_size);
+		const char* magic = reader.readBytes(sizeof(MAGIC));
+		if(magic == nullptr || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.readInteger() != VERSION ||
+		   !states[i] -> deserialize(reader) || reader.remaining() != 0)
+		{
+			errors[i] = -1;
+		}
+		munmap(contents, status.st_size);
+	}
+}
@@ -0,0 +1,85 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "summarizer.hpp"
+
+#ifndef STATEMERGER_H
+#define STATEMERGER_H
+
+/*
+ * Combines the patterns of separate scans, e.g. of the directories on different machines, which were each saved to a
+ * state file with StateMerger::save. The state files are loaded on several threads at once, then merged together in
+ * rounds by IngestPool::mergeTree, giving the same pattern as a single scan of every filename would have.
+ */
+class StateMerger
+{
+	public:
+		/*
+		 * Constructs a StateMerger object, and one empty Summarizer for each state file.
+		 * @param _paths the paths of the state files
+		 * @param _count the number of state files. Must be at least 1
+		 * @param delimiters passed on to the constructor of every Summarizer. Must be the delimiters the state files
+		 *        were saved with
+		 * @param options passed on to the constructor of every Summarizer. Must be the options the state files were
+		 *        saved with
+		 * @param _threadCount the number of threads to load state files on. Must be at least 1
+		 */
+		StateMerger(const char* const* _paths, std::size_t _count, const char* delimiters,
+		            const Summarizer::Options& options, unsigned _threadCount);
+
+		/*
+		 * Loads every state file, and merges their patterns together.
+		 * Halts program if a state file cannot be read, or was not saved in this locale with the same delimiters and
+		 * options.
+		 * @return the Summarizer holding the pattern of every filename in the state files
+		 */
+		Summarizer& merge();
+
+		/*
+		 * Saves a pattern to a state file, replacing it atomically.
+		 * Halts program if there is an error in writing.
+		 * @param summarizer holds the pattern
+		 * @param path the path of the state file
+		 */
+		static void save(const Summarizer& summarizer, const char* path);
+	private:
+		/* identifies a state file, and the version of its format */
+		static const char MAGIC[8];
+		static const unsigned VERSION = 1;
+
+		const char* const* paths; /* the paths of the state files */
+		std::size_t count; /* the number of state files */
+		unsigned threadCount; /* the number of threads to load state files on */
+		std::vector<std::unique_ptr<Summarizer>> states; /* the pattern of each state file, once loaded */
+		std::vector<int> errors; /* for each state file, the errno value of why it could not be read, or -1 if it is
+		                            malformed, or 0 */
+
+		/*
+		 * The body of each loading thread: loads every threadCount-th state file, starting from first.
+		 * @param first the index of the first state file to load
+		 */
+		void load(std::size_t first);
+};
+
+#endif /* STATEMERGER_H */
@@ -0,0 +1,97 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include "stats.hpp"
+
+bool Stats::enabled = false;
+
+/* the names of the stages and counters, as printed */
+static const char* STAGE_NAMES[Stats::STAGE_COUNT] = {
+	"read_directory", "prefixes", "transcode", "normalize", "grapheme_breaks", "align", "width", "insert", "merge",
+	"render", "write"
+};
+static const char* COUNTER_NAMES[Stats::COUNTER_COUNT] = {
+	"filenames", "ascii_filenames", "directories", "new_substrings", "duplicate_substrings", "shared_prefix_bytes",
+	"buffer_resets"
+};
+
+#ifndef PATTERN_NO_STATS
+void Stats::merge(const Stats& other)
+{
+	for(int i = 0; i < STAGE_COUNT; ++i)
+	{
+		nanoseconds[i] += other.nanoseconds[i];
+		calls[i] += other.calls[i];
+	}
+	for(int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		counters[i] += other.counters[i];
+	}
+}
+#endif
+
+void Stats::print(std::FILE* file, bool json, const std::vector<double>& cardinalities) const
+{
+#ifdef PATTERN_NO_STATS
+	// nothing was timed or counted, but the columns are still known
+	const std::int64_t nanoseconds[STAGE_COUNT] = {};
+	const std::uint64_t calls[STAGE_COUNT] = {};
+	const std::uint64_t counters[COUNTER_COUNT] = {};
+#endif
+
+	if(json)
+	{
+		std::fputs("{\"stages\": {", file);
+		for(int i = 0; i < STAGE_COUNT; ++i)
+		{
+			std::fprintf(file, "%s\"%s\": {\"seconds\": %.6f, \"calls\": %llu}", i == 0 ? "" : ", ", STAGE_NAMES[i],
+			             nanoseconds[i] / 1e9, (unsigned long long) calls[i]);
+		}
+		std::fputs("}, \"counters\": {", file);
+		for(int i = 0; i < COUNTER_COUNT; ++i)
+		{
+			std::fprintf(file, "%s\"%s\": %llu", i == 0 ? "" : ", ", COUNTER_NAMES[i], (unsigned long long) counters[i]);
+		}
+		std::fputs("}, \"column_cardinalities\": [", file);
+		for(std::size_t i = 0; i < cardinalities.size(); ++i)
+		{
+			std::fprintf(file, "%s%.0f", i == 0 ? "" : ", ", cardinalities[i]);
+		}
+		std::fputs("]}\n", file);
+		return;
+	}
+
+	std::fprintf(file, "%-20s %12s %12s\n", "stage", "seconds", "calls");
+	for(int i = 0; i < STAGE_COUNT; ++i)
+	{
+		std::fprintf(file, "%-20s %12.6f %12llu\n", STAGE_NAMES[i], nanoseconds[i] / 1e9, (unsigned long long) calls[i]);
+	}
+	std::fprintf(file, "\n%-20s %12s\n", "counter", "value");
+	for(int i = 0; i < COUNTER_COUNT; ++i)
+	{
+		std::fprintf(file, "%-20s %12llu\n", COUNTER_NAMES[i], (unsigned long long) counters[i]);
+	}
+	std::fprintf(file, "\n%-20s %12s\n", "column", "unique");
+	for(std::size_t i = 0; i < cardinalities.size(); ++i)
+	{
+		std::fprintf(file, "%-20zu %12.0f\n", i, cardinalities[i]);
+	}
+}
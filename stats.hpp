@@ -0,0 +1,175 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+#ifndef STATS_H
+#define STATS_H
+
+/*
+ * Time spent in each stage of summarizing filenames, and counts of what happened along the way, as printed by
+ * --stats. Each thread keeps a Stats object of its own, e.g. inside its Summarizer, and they are merged at the end, so
+ * nothing is shared while counting. Nothing is timed unless Stats::enabled is set, which costs one branch per stage;
+ * building with -DPATTERN_NO_STATS removes even that, leaving empty inline functions.
+ */
+class Stats
+{
+	public:
+		/* the stages which are timed */
+		enum Stage
+		{
+			READ_DIRECTORY, /* reading directory entries from the filesystem */
+			PREFIXES, /* looking filenames' prefixes up in a PrefixTrie, and adding them to it */
+			TRANSCODE, /* transcoding filenames from the user's locale to utf-8 */
+			NORMALIZE, /* checking whether filenames are normalized, and normalizing the others with u8_normalize */
+			GRAPHEME_BREAKS, /* finding grapheme clusters with u8_grapheme_breaks, or with segmentGraphemes (which finds
+			                    the display widths of substrings too) */
+			ALIGN, /* choosing the column of each substring of a filename, when aligning filenames */
+			WIDTH, /* computing the display width of new substrings with u8_width, or looking it up */
+			INSERT, /* looking substrings up in their column, and adding new ones (including WIDTH) */
+			MERGE, /* merging the Summarizers of several threads */
+			RENDER, /* sorting, encoding and laying out the summary */
+			WRITE, /* writing the summary out */
+			STAGE_COUNT
+		};
+
+		/* the events which are counted */
+		enum Counter
+		{
+			FILENAMES, /* filenames ingested */
+			ASCII_FILENAMES, /* filenames which skipped transcoding, normalization and segmentation */
+			DIRECTORIES, /* directories read */
+			NEW_SUBSTRINGS, /* substrings which were added to their column */
+			DUPLICATE_SUBSTRINGS, /* substrings which were already in their column */
+			SHARED_PREFIX_BYTES, /* bytes of filenames whose substrings were found in a PrefixTrie */
+			BUFFER_RESETS, /* buffers which libunistring had to reallocate */
+			COUNTER_COUNT
+		};
+
+		/* whether stages are timed and events counted at all */
+		static bool enabled;
+
+#ifdef PATTERN_NO_STATS
+		void addTime(Stage, std::int64_t) {}
+		void count(Counter, std::uint64_t = 1) {}
+		void merge(const Stats&) {}
+		static std::int64_t now() { return 0; }
+#else
+		Stats() : nanoseconds(), calls(), counters() {}
+
+		/*
+		 * Adds the time spent in one pass through a stage.
+		 * @param stage the stage
+		 * @param time the number of nanoseconds spent in the stage
+		 */
+		void addTime(Stage stage, std::int64_t time)
+		{
+			nanoseconds[stage] += time;
+			++calls[stage];
+		}
+
+		/*
+		 * Counts an event.
+		 * @param counter the kind of event
+		 * @param n the number of times it happened
+		 */
+		void count(Counter counter, std::uint64_t n = 1)
+		{
+			if(enabled)
+			{
+				counters[counter] += n;
+			}
+		}
+
+		/*
+		 * Adds up another Stats object's times and counts into this one's.
+		 * @param other the Stats object to add. Left unchanged
+		 */
+		void merge(const Stats& other);
+
+		/*
+		 * @return the time on a clock which only moves forwards, in nanoseconds
+		 */
+		static std::int64_t now()
+		{
+			timespec time;
+			clock_gettime(CLOCK_MONOTONIC, &time);
+			return time.tv_sec * 1000000000LL + time.tv_nsec;
+		}
+#endif
+
+		/*
+		 * Prints every time and count, followed by the number of unique substrings in each column of the pattern.
+		 * @param file where to print to
+		 * @param json whether to print a JSON object instead of a table
+		 * @param cardinalities the number of unique substrings in each column, possibly estimated
+		 */
+		void print(std::FILE* file, bool json, const std::vector<double>& cardinalities) const;
+	private:
+#ifndef PATTERN_NO_STATS
+		std::int64_t nanoseconds[STAGE_COUNT]; /* the time spent in each stage */
+		std::uint64_t calls[STAGE_COUNT]; /* the number of passes through each stage */
+		std::uint64_t counters[COUNTER_COUNT]; /* the number of each kind of event */
+#endif
+};
+
+/*
+ * Times the rest of the scope it is declared in as one pass through a stage, if Stats::enabled is set.
+ */
+class StageTimer
+{
+	public:
+#ifdef PATTERN_NO_STATS
+		StageTimer(Stats&, Stats::Stage) {}
+#else
+		/*
+		 * Constructs a StageTimer object, and starts timing.
+		 * @param _stats where to add the time to
+		 * @param _stage the stage being timed
+		 */
+		StageTimer(Stats& _stats, Stats::Stage _stage) :
+					stats(_stats),
+					stage(_stage),
+					start(Stats::enabled ? Stats::now() : -1)
+		{}
+
+		/*
+		 * Stops timing, and adds the time taken to the stage.
+		 */
+		~StageTimer()
+		{
+			if(start >= 0)
+			{
+				stats.addTime(stage, Stats::now() - start);
+			}
+		}
+	private:
+		Stats& stats; /* where to add the time to */
+		const Stats::Stage stage; /* the stage being timed */
+		const std::int64_t start; /* when timing started, or -1 if nothing is timed */
+#endif
+};
+
+#endif /* STATS_H */
@@ -0,0 +1,95 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "streamreader.hpp"
+
+void ingestStream(IngestPool& pool, int fd, char separator)
+{
+	IngestPool::Block* block = pool.acquireBlock();
+	block -> separator = separator;
+
+	while(true)
+	{
+		if(block -> size == block -> capacity)
+		{
+			// the block is full, so look for the end of the last complete filename in it
+			char* lastSeparator = block -> data + block -> size;
+			while(lastSeparator != block -> data && *(lastSeparator - 1) != separator)
+			{
+				--lastSeparator;
+			}
+
+			if(lastSeparator == block -> data)
+			{
+				// a single filename fills the entire block, so make room for the rest of it
+				IngestPool::growBlock(block, block -> capacity * 2);
+			}
+			else
+			{
+				// move the incomplete filename at the end of the block over to the next block, and submit this one
+				IngestPool::Block* next = pool.acquireBlock();
+				next -> separator = separator;
+				std::size_t tailLength = block -> data + block -> size - lastSeparator;
+				IngestPool::growBlock(next, tailLength + 1);
+				std::memcpy(next -> data, lastSeparator, tailLength);
+				next -> size = tailLength;
+
+				block -> size -= tailLength;
+				pool.submitBlock(block);
+				block = next;
+			}
+		}
+
+		if(pool.isExpired())
+		{
+			// the rest of the input is never read, so the incomplete filename at the end of the block is dropped
+			while(block -> size != 0 && block -> data[block -> size - 1] != separator)
+			{
+				--block -> size;
+			}
+			break;
+		}
+
+		ssize_t bytesRead = read(fd, block -> data + block -> size, block -> capacity - block -> size);
+		if(bytesRead < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			std::perror(nullptr);
+			std::exit(EXIT_FAILURE);
+		}
+		if(bytesRead == 0)
+		{
+			break;
+		}
+		block -> size += bytesRead;
+	}
+
+	// the last filename is allowed to go without a separator
+	pool.submitBlock(block);
+}
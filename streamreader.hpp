@@ -0,0 +1,39 @@
+/*
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+* pattern: Summarizes the pattern in a group of filenames by slicing each one into    *
+*          substrings, grouping together the Nth substrings from every filename, and  *
+*          printing the unique substrings found in each of the N groups.              *
+* Copyright (C) 2022  Joe Antaki  ->  joeantaki3 at gmail dot com                     *
+*                                                                                     *
+* This program is free software: you can redistribute it and/or modify                *
+* it under the terms of the GNU General Public License as published by                *
+* the Free Software Foundation, either version 3 of the License, or                   *
+* (at your option) any later version.                                                 *
+*                                                                                     *
+* This program is distributed in the hope that it will be useful,                     *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of                      *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                       *
+* GNU General Public License for more details.                                        *
+*                                                                                     *
+* You should have received a copy of the GNU General Public License                   *
+* along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
+* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+#include "ingestpool.hpp"
+
+#ifndef STREAMREADER_H
+#define STREAMREADER_H
+
+/*
+ * Reads a list of filenames from a file descriptor until end of file, or until the IngestPool's time budget runs out,
+ * and submits them to an IngestPool. The input is read straight into the pool's blocks, so reading overlaps with the
+ * ingestion of earlier blocks, and the amount of memory used stays the same however long the input is. Only a
+ * filename which straddles the end of a block is ever moved, to the start of the next block.
+ * Halts program if there is an error reading from fd.
+ * @param pool the IngestPool to submit the filenames to
+ * @param fd the file descriptor to read from, e.g. STDIN_FILENO
+ * @param separator the character that ends each filename in the input, e.g. '\n' or '\0'
+ */
+void ingestStream(IngestPool& pool, int fd, char separator);
+
+#endif /* STREAMREADER_H */
@@ -19,249 +19,1630 @@
 * along with this program.  If not, see <https://www.gnu.org/licenses/>.              *
 * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
 */
-#include <clocale>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
 #include <cstring>
 #include <cstdio>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <sys/uio.h>
 #include <uniconv.h>
 #include <uninorm.h>
 #include <unigbrk.h>
+#include <unistr.h>
 #include <uniwidth.h>
 #include "summarizer.hpp"
+#include "bytescan.hpp"
+#include "segmenter.hpp"
 
-Summarizer::Summarizer(const char* _delimiters) :
+Summarizer::Summarizer(const char* _delimiters, const Options& _options) :
 			greatestCommonChunkIndex(SIZE_MAX),
 			patternIndex(0),
-			colLimit(-1)
+			options(_options),
+			status(0),
+			colLimit(-1),
+			checkedPrefixBytes(0),
+			sharedPrefixBytes(0)
 {
-	std::setlocale(LC_ALL, "");
     localeCode = locale_charset();
+    utf8Locale = std::strcmp(localeCode, "UTF-8") == 0;
+    cjkWidths = usesCjkWidths(localeCode);
+    converter.reset(new LocaleConverter(localeCode));
 
-	if(_delimiters != nullptr)
+    // check whether the user's locale encodes the printable ASCII characters just like utf-8 does, which is what
+    // allows filenames made up of only those characters to skip transcoding (almost every locale does, but e.g.
+    // Shift_JIS has a yen sign in place of '\\')
+    char printableAscii[0x7F - 0x20];
+    for(int i = 0; i < 0x7F - 0x20; ++i)
+    {
+        printableAscii[i] = 0x20 + i;
+    }
+    asciiCompatible = false;
+    asciiCompatible = ingestString(printableAscii, sizeof(printableAscii)) == 0 &&
+                      processedLength == sizeof(printableAscii) &&
+                      std::memcmp(processedString, printableAscii, sizeof(printableAscii)) == 0;
+
+	splitMode = NO_DELIMITERS;
+    // transcode delimiters to utf-8, normalize them, and compute the boundaries between grapheme clusters
+	if(_delimiters != nullptr && ingestString(_delimiters, std::strlen(_delimiters)) == 0)
+	{
+		const char* graphemeBreaks = charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
+		const uint8_t* processedDelimiters = processedString;
+		std::size_t processedDelimitersLength = processedLength;
+
+		std::size_t first = 0;
+		std::size_t last = 1;
+
+        // count each grapheme cluster as a separate delimiter
+		for(; last <= processedDelimitersLength; ++last)
+		{
+			if(last == processedDelimitersLength || asciiString || graphemeBreaks[last])
+			{
+				uint8_string delimiter(processedDelimiters + first, last - first);
+				if(std::find(delimiters.begin(), delimiters.end(), delimiter) == delimiters.end())
+				{
+					delimiters.push_back(delimiter);
+				}
+				first = last;
+			}
+		}
+		if(processedDelimitersLength == 0)
+		{
+			// an empty delimiter never matches, so that filenames don't get split at all
+			delimiters.emplace_back();
+		}
+
+		splitMode = BYTE_DELIMITERS;
+		for(auto it = delimiters.begin(); it != delimiters.end(); ++it)
+		{
+			if(it -> size() != 1)
+			{
+				splitMode = GRAPHEME_DELIMITERS;
+			}
+			if(!it -> empty())
+			{
+				delimiterBytes.add(it -> front());
+			}
+		}
+	}
+}
+
+int Summarizer::inputFilename(const char* filename)
+{
+	return inputFilename(filename, std::strlen(filename));
+}
+
+int Summarizer::inputFilename(const char* filename, std::size_t length)
+{
+    // transcode filename to utf-8, normalize it, compute the boundaries between grapheme clusters, and add its
+    // substrings to the pattern
+	int error = insertFilename(filename, length);
+	if(error != 0)
+	{
+		return error;
+	}
+	stats.count(Stats::FILENAMES);
+	if(asciiString)
+	{
+		stats.count(Stats::ASCII_FILENAMES);
+	}
+
+	if(filenamesByChunkCount.size() <= patternIndex)
+	{
+		filenamesByChunkCount.resize(patternIndex + 1);
+	}
+	++filenamesByChunkCount[patternIndex];
+
+	if(patternIndex < greatestCommonChunkIndex)
+	{
+		greatestCommonChunkIndex = patternIndex;
+	}
+	return 0;
+}
+
+int Summarizer::inputFilenames(const char* const* filenames, std::size_t count)
+{
+	// the fewest substrings of any filename in the batch, and the number of filenames split into each number of
+	// substrings, are only added to the pattern's totals at the end
+	std::size_t fewestChunks = SIZE_MAX;
+	std::vector<std::size_t> batchChunkCounts;
+	std::size_t ingested = 0;
+	std::size_t asciiFilenames = 0;
+	int firstError = 0;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		int error = insertFilename(filenames[i], std::strlen(filenames[i]));
+		if(error != 0)
+		{
+			if(firstError == 0)
+			{
+				firstError = error;
+			}
+			continue;
+		}
+		++ingested;
+		asciiFilenames += asciiString;
+
+		if(batchChunkCounts.size() <= patternIndex)
+		{
+			batchChunkCounts.resize(patternIndex + 1);
+		}
+		++batchChunkCounts[patternIndex];
+		fewestChunks = std::min(fewestChunks, patternIndex);
+	}
+
+	stats.count(Stats::FILENAMES, ingested);
+	stats.count(Stats::ASCII_FILENAMES, asciiFilenames);
+	if(filenamesByChunkCount.size() < batchChunkCounts.size())
+	{
+		filenamesByChunkCount.resize(batchChunkCounts.size());
+	}
+	for(std::size_t i = 0; i < batchChunkCounts.size(); ++i)
+	{
+		filenamesByChunkCount[i] += batchChunkCounts[i];
+	}
+	greatestCommonChunkIndex = std::min(greatestCommonChunkIndex, fewestChunks);
+	return firstError;
+}
+
+int Summarizer::removeFilename(const char* filename, std::size_t length)
+{
+	if(options.alignBand != 0)
+	{
+		// the columns which the filename's substrings were aligned with may have moved since
+		return ENOTSUP;
+	}
+	int error = ingestString(filename, length);
+	if(error != 0)
+	{
+		return error;
+	}
+	splitIngestedString<&Summarizer::removeFromNextColumn>();
+
+	// once removed substrings take up more of the arena than those left, e.g. as files keep coming and going in a
+	// watched directory, copy the rest to a new arena, so that memory use follows the size of the pattern instead
+	// of the number of filenames ever seen, at the cost of copying no more bytes than were removed
+	std::size_t releasedBytes = arena.getReleasedBytes();
+	if(releasedBytes >= MIN_COMPACTED_BYTES && 2 * releasedBytes > arena.getAppendedBytes())
+	{
+		compactArena();
+	}
+
+	if(patternIndex >= filenamesByChunkCount.size() || filenamesByChunkCount[patternIndex] == 0)
+	{
+		// no filename with that many substrings was ever ingested
+		return 0;
+	}
+
+	if(--filenamesByChunkCount[patternIndex] == 0 && patternIndex == greatestCommonChunkIndex)
+	{
+		// that was the last of the shortest filenames, so the next shortest ones determine the common index now
+		greatestCommonChunkIndex = SIZE_MAX;
+		for(std::size_t i = patternIndex + 1; i < filenamesByChunkCount.size(); ++i)
+		{
+			if(filenamesByChunkCount[i] != 0)
+			{
+				greatestCommonChunkIndex = i;
+				break;
+			}
+		}
+	}
+
+	// any sets at the end of the pattern which only the removed filename reached are empty now
+	while(!pattern.empty() && pattern.back().size() == 0 && !sketches.back())
+	{
+		pattern.pop_back();
+		sketches.pop_back();
+		renderedColumns.pop_back();
+	}
+	while(!filenamesByChunkCount.empty() && filenamesByChunkCount.back() == 0)
+	{
+		filenamesByChunkCount.pop_back();
+	}
+	return 0;
+}
+
+template <Summarizer::SubstringVisitor visit>
+void Summarizer::splitIngestedString(std::size_t firstIndex)
+{
+	const char* graphemeBreaks = charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
+
+	patternIndex = firstIndex;
+	switch(splitMode)
+	{
+		case NO_DELIMITERS:
+			if(asciiString)
+			{
+				splitString<NO_DELIMITERS, true, visit>(graphemeBreaks);
+			}
+			else
+			{
+				splitString<NO_DELIMITERS, false, visit>(graphemeBreaks);
+			}
+			break;
+		case BYTE_DELIMITERS:
+			if(asciiString)
+			{
+				splitString<BYTE_DELIMITERS, true, visit>(graphemeBreaks);
+			}
+			else
+			{
+				splitString<BYTE_DELIMITERS, false, visit>(graphemeBreaks);
+			}
+			break;
+		case GRAPHEME_DELIMITERS:
+			if(asciiString)
+			{
+				splitString<GRAPHEME_DELIMITERS, true, visit>(graphemeBreaks);
+			}
+			else
+			{
+				splitString<GRAPHEME_DELIMITERS, false, visit>(graphemeBreaks);
+			}
+			break;
+	}
+}
+
+template <Summarizer::SplitMode mode, bool ascii, Summarizer::SubstringVisitor visit>
+void Summarizer::splitString(const char* graphemeBreaks)
+{
+	const uint8_t* processedFilename = processedString;
+	std::size_t processedFilenameLength = processedLength;
+
+	if(processedFilenameLength == 0)
+	{
+		(this ->* visit)(processedFilename, 0, 0);
+		return;
+	}
+
+	std::size_t first = 0; // the start of the current substring under inspection, which has not yet been added to the pattern
+
+	if(mode == NO_DELIMITERS)
+	{
+		// every grapheme cluster is a substring of its own
+		for(std::size_t last = 1; last < processedFilenameLength; ++last)
+		{
+			if(ascii || graphemeBreaks[last])
+			{
+				(this ->* visit)(processedFilename, first, last);
+				first = last;
+			}
+		}
+	}
+	else if(mode == BYTE_DELIMITERS)
+	{
+		// jump straight to each byte that could be a delimiter. It really is one if it is a grapheme cluster of its
+		// own, and not e.g. the start of a '.' followed by a combining accent
+		std::size_t position = 0;
+		while((position += delimiterBytes.find(processedFilename + position, processedFilenameLength - position)) <
+		      processedFilenameLength)
+		{
+			if(ascii || ((position == 0 || graphemeBreaks[position]) &&
+			             (position + 1 == processedFilenameLength || graphemeBreaks[position + 1])))
+			{
+				// add any characters accumulated in [first, position) due to them not being delimiters to the next
+				// column first, and then add the delimiter itself to the following column
+				if(first != position)
+				{
+					(this ->* visit)(processedFilename, first, position);
+				}
+				(this ->* visit)(processedFilename, position, position + 1);
+				//TODO: could encountering two delimiters in a row be presented better, e.g. create a new column right there for
+				// the second delimiter in a row and push the subsequent columns over by one? (make pattern a list)
+				first = position + 1;
+			}
+			++position;
+		}
+	}
+	else
+	{
+		std::size_t prev = 0; // the start of the current grapheme cluster under inspection
+		for(std::size_t last = 1; last <= processedFilenameLength; ++last)
+		{
+			if(last == processedFilenameLength || ascii || graphemeBreaks[last])
+			{
+				// we have reached the end of the current grapheme cluster [prev, last). If it is a delimiter, add any
+				// characters accumulated in [first, prev) to the next column, then the delimiter to the following one
+				if(isDelimiter(processedFilename + prev, last - prev))
+				{
+					if(first != prev)
+					{
+						(this ->* visit)(processedFilename, first, prev);
+					}
+					(this ->* visit)(processedFilename, prev, last);
+					first = last;
+				}
+				prev = last;
+			}
+		}
+	}
+
+	// whatever follows the last delimiter is the last substring
+	if(first != processedFilenameLength)
+	{
+		(this ->* visit)(processedFilename, first, processedFilenameLength);
+	}
+}
+
+bool Summarizer::isDelimiter(const uint8_t* s, std::size_t n) const
+{
+	if(!delimiterBytes.contains(s[0]))
+	{
+		return false;
+	}
+
+	for(auto it = delimiters.begin(); it != delimiters.end(); ++it)
+	{
+		if(it -> size() == n && std::memcmp(it -> data(), s, n) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Summarizer::merge(const Summarizer& other)
+{
+	if(other.status != 0)
+	{
+		fail(other.status);
+	}
+
+	const std::size_t otherPatternSize = other.pattern.size();
+	for(std::size_t i = 0; i < otherPatternSize; ++i)
+	{
+		if(pattern.size() == i)
+		{
+			// create a new column (set) in the pattern
+			addColumn();
+		}
+
+		renderedColumns[i].dirty = true;
+		if(other.sketches[i])
+		{
+			// a sketch can only be merged into another sketch
+			if(!sketches[i])
+			{
+				sketchColumn(i);
+			}
+			sketches[i] -> merge(*other.sketches[i]);
+		}
+		else
+		{
+			// the other Summarizer's chunks are copied into this one's arena, unless they are already in the column
+			const std::vector<ChunkArena::Handle>& otherHandles = other.pattern[i].getHandles();
+			const std::vector<std::size_t>& otherCounts = other.pattern[i].getCounts();
+			for(std::size_t j = 0; j < otherHandles.size(); ++j)
+			{
+				const ChunkArena::Handle& handle = otherHandles[j];
+				if(sketches[i])
+				{
+					sketches[i] -> insert(other.arena.data(handle), handle.length, handle.width, otherCounts[j]);
+				}
+				else if(pattern[i].insert(other.arena.data(handle), handle.length, handle.width, otherCounts[j]) &&
+				        options.maxUnique != 0 && pattern[i].size() > options.maxUnique)
+				{
+					sketchColumn(i);
+				}
+			}
+		}
+	}
+
+	if(other.greatestCommonChunkIndex < greatestCommonChunkIndex)
+	{
+		greatestCommonChunkIndex = other.greatestCommonChunkIndex;
+	}
+
+	stats.merge(other.stats);
+
+	if(filenamesByChunkCount.size() < other.filenamesByChunkCount.size())
+	{
+		filenamesByChunkCount.resize(other.filenamesByChunkCount.size());
+	}
+	for(std::size_t i = 0; i < other.filenamesByChunkCount.size(); ++i)
+	{
+		filenamesByChunkCount[i] += other.filenamesByChunkCount[i];
+	}
+}
+
+void Summarizer::serialize(StateWriter& writer) const
+{
+	writer.writeString(localeCode, std::strlen(localeCode));
+	writer.writeInteger(splitMode);
+	writer.writeInteger(delimiters.size());
+	for(auto it = delimiters.cbegin(); it != delimiters.cend(); ++it)
+	{
+		writer.writeString(it -> data(), it -> size());
+	}
+	writer.writeInteger(options.maxUnique);
+
+	writer.writeInteger(filenamesByChunkCount.size());
+	for(auto it = filenamesByChunkCount.cbegin(); it != filenamesByChunkCount.cend(); ++it)
+	{
+		writer.writeInteger(*it);
+	}
+
+	// each set is written as whether it was replaced by a sketch, then either the sketch, or its number of substrings
+	// and the bytes, width and occurrences of each substring
+	writer.writeInteger(pattern.size());
+	for(std::size_t i = 0; i < pattern.size(); ++i)
+	{
+		writer.writeInteger(sketches[i] ? 1 : 0);
+		if(sketches[i])
+		{
+			sketches[i] -> serialize(writer);
+			continue;
+		}
+
+		const std::vector<ChunkArena::Handle>& handles = pattern[i].getHandles();
+		const std::vector<std::size_t>& counts = pattern[i].getCounts();
+		writer.writeInteger(handles.size());
+		for(std::size_t j = 0; j < handles.size(); ++j)
+		{
+			writer.writeString(arena.data(handles[j]), handles[j].length);
+			writer.writeInteger(handles[j].width);
+			writer.writeInteger(counts[j]);
+		}
+	}
+}
+
+bool Summarizer::deserialize(StateReader& reader)
+{
+	// a pattern computed in another locale or with other delimiters would have split filenames differently
+	std::size_t length;
+	const char* code = reader.readString(length);
+	if(code == nullptr || length != std::strlen(localeCode) || std::memcmp(code, localeCode, length) != 0 ||
+	   reader.readInteger() != (std::uint64_t) splitMode || reader.readInteger() != delimiters.size())
+	{
+		return false;
+	}
+	for(auto it = delimiters.cbegin(); it != delimiters.cend(); ++it)
+	{
+		const char* delimiter = reader.readString(length);
+		if(delimiter == nullptr || length != it -> size() || std::memcmp(delimiter, it -> data(), length) != 0)
+		{
+			return false;
+		}
+	}
+	if(reader.readInteger() != options.maxUnique)
+	{
+		return false;
+	}
+
+	// every count is checked against the number of bytes left to read before anything is allocated for it, since
+	// each item takes up at least one byte, and every substring is checked to be one that ingesting could have
+	// added, with the width it would have had, so that a corrupted file cannot use up all memory, even when printed
+	std::size_t histogramSize = reader.readInteger();
+	if(histogramSize > reader.remaining())
+	{
+		return false;
+	}
+	std::vector<std::size_t> histogram(histogramSize);
+	for(auto it = histogram.begin(); it != histogram.end(); ++it)
+	{
+		*it = reader.readInteger();
+	}
+
+	std::size_t columnCount = reader.readInteger();
+	if(reader.hasFailed() || columnCount > reader.remaining())
+	{
+		return false;
+	}
+
+	pattern.clear();
+	sketches.clear();
+	renderedColumns.clear();
+	prefixes.clear();
+	bool malformed = false;
+	for(std::size_t i = 0; i < columnCount && !reader.hasFailed() && !malformed; ++i)
+	{
+		addColumn();
+		std::uint64_t sketched = reader.readInteger();
+		if(sketched != 0)
+		{
+			// only a Summarizer with a limit on unique substrings replaces sets with sketches
+			malformed = sketched != 1 || options.maxUnique == 0;
+			if(!malformed)
+			{
+				sketches[i].reset(new ColumnSketch(options.maxUnique));
+				malformed = !sketches[i] -> deserialize(reader);
+			}
+			if(!malformed)
+			{
+				const std::vector<ColumnSketch::Counter>& counters = sketches[i] -> getCounters();
+				for(auto it = counters.cbegin(); it != counters.cend() && !malformed; ++it)
+				{
+					malformed = it -> count == 0 ||
+					            !isValidSavedChunk(it -> chunk.data(), it -> chunk.size(), it -> width);
+				}
+			}
+			continue;
+		}
+
+		std::size_t chunkCount = reader.readInteger();
+		if(chunkCount > reader.remaining())
+		{
+			malformed = true;
+			break;
+		}
+
+		for(std::size_t j = 0; j < chunkCount; ++j)
+		{
+			const uint8_t* chunk = (const uint8_t*) reader.readString(length);
+			std::uint64_t width = reader.readInteger();
+			std::size_t count = reader.readInteger();
+			if(reader.hasFailed())
+			{
+				break;
+			}
+
+			// each substring of a set is saved once, with the number of filenames that had it
+			if(count == 0 || !isValidSavedChunk(chunk, length, width))
+			{
+				malformed = true;
+				break;
+			}
+			ChunkColumn::Probe probe = pattern[i].probe(chunk, length);
+			if(probe.found)
+			{
+				malformed = true;
+				break;
+			}
+			pattern[i].add(probe, chunk, length, width, count);
+		}
+	}
+
+	if(reader.hasFailed() || malformed || pattern.size() != columnCount)
+	{
+		pattern.clear();
+		sketches.clear();
+		renderedColumns.clear();
+		return false;
+	}
+
+	filenamesByChunkCount.swap(histogram);
+	greatestCommonChunkIndex = SIZE_MAX;
+	for(std::size_t i = 0; i < filenamesByChunkCount.size(); ++i)
+	{
+		if(filenamesByChunkCount[i] != 0)
+		{
+			greatestCommonChunkIndex = i;
+			break;
+		}
+	}
+	return true;
+}
+
+int Summarizer::printSummary()
+{
+	std::vector<char> output;
+	if(renderSummary(output) != 0)
+	{
+		return status;
+	}
+
+	// print out the pattern summary, keeping in mind the column limit of the user's terminal
+	// TODO: keep in mind the column limit of the user's terminal. ulc_grapheme_breaks to know where to break this text?
+	StageTimer timer(stats, Stats::WRITE);
+	std::fflush(stdout);
+	int error = writeFully(STDOUT_FILENO, output.data(), output.size());
+	if(error != 0)
+	{
+		fail(error);
+	}
+	return status;
+}
+
+void Summarizer::printStats(bool json) const
+{
+	std::vector<double> cardinalities;
+	for(std::size_t i = 0; i < pattern.size(); ++i)
+	{
+		cardinalities.push_back(sketches[i] ? sketches[i] -> estimateUnique() : pattern[i].size());
+	}
+	stats.print(stderr, json, cardinalities);
+}
+
+int Summarizer::renderSummary(std::vector<char>& output)
+{
+	output.clear();
+	if(status != 0)
+	{
+		return status;
+	}
+	StageTimer timer(stats, Stats::RENDER);
+
+	// sort the substrings of every column which changed since it was last rendered, and re-encode each one in the
+	// user's locale, just once
+	const std::size_t patternSize = pattern.size();
+	std::vector<int> widths(patternSize, 0);
+	for(std::size_t i = 0; i < patternSize; ++i)
+	{
+		RenderedColumn& column = renderedColumns[i];
+		// a percentage changes whenever any filename is added or removed, even one with no substring in this column
+		if(column.dirty || layout.counts == Layout::PERCENTAGES)
+		{
+			column.encodings.reset(new ChunkArena);
+			if(encodeColumn(i, *column.encodings, column.cells) != 0)
+			{
+				return status;
+			}
+			column.dirty = false;
+		}
+		// each column is as wide as the widest substring printed in it, along with any count beside it. Finding that
+		// here, rather than keeping track of it as substrings come and go, means that removing the widest one costs
+		// nothing until the next render, which goes over every cell anyway
+		for(auto it = column.cells.cbegin(); it != column.cells.cend(); ++it)
+		{
+			widths[i] = std::max(widths[i], it -> width);
+		}
+	}
+
+	// scan for the "tallest column" (largest set) in the pattern. This will dictate the amount of rows in the output
+	std::size_t tallestColumnSize = 0;
+	for(std::size_t i = 0; i < patternSize; ++i)
+	{
+		/*TODO:
+		std::size_t currSize = pattern[i].size();
+		if(i > greatestCommonChunkIndex)
+		{
+			//behavior for adding blank space under chunks going past the smallest common chunk length
+			++currSize;
+		}
+		*/
+
+		if(renderedColumns[i].cells.size() > tallestColumnSize)
+		{
+			tallestColumnSize = renderedColumns[i].cells.size();
+		}
+	}
+
+	// add up the exact number of bytes in the output: each row has every column padded to its highest width, a space
+	// between columns, and a newline
+	std::size_t outputSize = tallestColumnSize * patternSize;
+	for(std::size_t i = 0; i < patternSize; ++i)
+	{
+		const std::vector<Cell>& cells = renderedColumns[i].cells;
+		outputSize += (tallestColumnSize - cells.size()) * widths[i];
+		for(auto it = cells.begin(); it != cells.end(); ++it)
+		{
+			outputSize += it -> length + widths[i] - it -> width;
+		}
+	}
+
+	// write the whole pattern summary into a single buffer, one row at a time. Each column's substrings fill up the
+	// bottom rows of the column, and are padded such that each column has a consistent start and end column on screen
+	output.resize(outputSize);
+	char* outputPointer = output.data();
+	for(std::size_t row = 0; row < tallestColumnSize; ++row)
+	{
+		for(std::size_t i = 0; i < patternSize; ++i)
+		{
+			const std::vector<Cell>& cells = renderedColumns[i].cells;
+			std::size_t blankRows = tallestColumnSize - cells.size();
+			std::size_t padding = widths[i];
+			if(row >= blankRows)
+			{
+				const Cell& cell = cells[row - blankRows];
+				std::memcpy(outputPointer, cell.bytes, cell.length);
+				outputPointer += cell.length;
+				padding -= cell.width;
+			}
+			std::memset(outputPointer, ' ', padding);
+			outputPointer += padding;
+
+			if(i != patternSize - 1)
+			{
+				*outputPointer++ = ' '; //column divider
+			}
+		}
+		*outputPointer++ = '\n';
+	}
+	return 0;
+}
+
+void Summarizer::setLayout(const Layout& _layout)
+{
+	layout = _layout;
+	for(auto it = renderedColumns.begin(); it != renderedColumns.end(); ++it)
+	{
+		it -> dirty = true;
+	}
+}
+
+void Summarizer::visitPattern(PatternVisitor& visitor) const
+{
+	for(std::size_t i = 0; i < pattern.size(); ++i)
+	{
+		if(sketches[i])
+		{
+			const ColumnSketch& sketch = *sketches[i];
+			visitor.visitColumn(i, sketch.estimateUnique(), true);
+			for(auto it = sketch.getCounters().cbegin(); it != sketch.getCounters().cend(); ++it)
+			{
+				visitor.visitChunk(it -> chunk.data(), it -> chunk.size(), it -> width, it -> count);
+			}
+			continue;
+		}
+
+		const std::vector<ChunkArena::Handle>& handles = pattern[i].getHandles();
+		const std::vector<std::size_t>& counts = pattern[i].getCounts();
+		visitor.visitColumn(i, handles.size(), false);
+		for(std::size_t j = 0; j < handles.size(); ++j)
+		{
+			visitor.visitChunk(arena.data(handles[j]), handles[j].length, handles[j].width, counts[j]);
+		}
+	}
+}
+
+int Summarizer::encodeColumn(std::size_t index, ChunkArena& encodings, std::vector<Cell>& cells)
+{
+	std::size_t filenames = 0;
+	for(auto it = filenamesByChunkCount.cbegin(); it != filenamesByChunkCount.cend(); ++it)
+	{
+		filenames += *it;
+	}
+
+	std::size_t hidden = 0;
+	if(sketches[index])
+	{
+		// a sketched column shows its estimated number of unique substrings, followed by those of its substrings
+		// which are certain to have occurred more than once
+		const ColumnSketch& sketch = *sketches[index];
+		cells.resize(1);
+		int error = encodeText(describeSketch(sketch), encodings, cells[0]);
+		if(error != 0)
+		{
+			return error;
+		}
+
+		std::vector<const ColumnSketch::Counter*> repeated;
+		for(auto it = sketch.getCounters().cbegin(); it != sketch.getCounters().cend(); ++it)
+		{
+			if(it -> count - it -> error >= 2)
+			{
+				repeated.push_back(&*it);
+			}
+		}
+		hidden = arrangeColumn(repeated,
+		                       [](const ColumnSketch::Counter* c) { return c -> count; },
+		                       [](const ColumnSketch::Counter* a, const ColumnSketch::Counter* b)
+		                       {
+		                           return a -> chunk < b -> chunk;
+		                       });
+
+		cells.resize(1 + repeated.size());
+		for(std::size_t i = 0; i < repeated.size(); ++i)
+		{
+			error = encodeCell(repeated[i] -> chunk.data(), repeated[i] -> chunk.size(), repeated[i] -> width,
+			                   encodings, cells[1 + i]);
+			if(error == 0 && layout.counts != Layout::NO_COUNTS)
+			{
+				// a sketch's counts may be overestimated by up to the counter's error
+				error = annotateCell(cells[1 + i], repeated[i] -> count, repeated[i] -> error != 0, filenames,
+				                     encodings);
+			}
+			if(error != 0)
+			{
+				return error;
+			}
+		}
+	}
+	else if(!layout.usesCounts())
+	{
+		std::vector<ChunkArena::Handle> sortedColumn;
+		pattern[index].sortedHandles(sortedColumn);
+
+		cells.resize(sortedColumn.size());
+		auto cell = cells.begin();
+		for(auto it = sortedColumn.cbegin(); it != sortedColumn.cend(); ++it, ++cell)
+		{
+			int error = encodeCell(arena.data(*it), it -> length, it -> width, encodings, *cell);
+			if(error != 0)
+			{
+				return error;
+			}
+		}
+	}
+	else
+	{
+		// the substrings are arranged by their positions in the column, since their counts are kept alongside them
+		const std::vector<ChunkArena::Handle>& handles = pattern[index].getHandles();
+		const std::vector<std::size_t>& counts = pattern[index].getCounts();
+		std::vector<std::size_t> positions(handles.size());
+		for(std::size_t i = 0; i < positions.size(); ++i)
+		{
+			positions[i] = i;
+		}
+		ChunkComparator byChunk{&arena};
+		hidden = arrangeColumn(positions,
+		                       [&counts](std::size_t i) { return counts[i]; },
+		                       [&handles, &byChunk](std::size_t a, std::size_t b)
+		                       {
+		                           return byChunk(handles[a], handles[b]);
+		                       });
+
+		cells.resize(positions.size());
+		for(std::size_t i = 0; i < positions.size(); ++i)
+		{
+			const ChunkArena::Handle& handle = handles[positions[i]];
+			int error = encodeCell(arena.data(handle), handle.length, handle.width, encodings, cells[i]);
+			if(error == 0 && layout.counts != Layout::NO_COUNTS)
+			{
+				error = annotateCell(cells[i], counts[positions[i]], false, filenames, encodings);
+			}
+			if(error != 0)
+			{
+				return error;
+			}
+		}
+	}
+
+	if(hidden != 0)
+	{
+		cells.emplace_back();
+		return encodeText("+" + std::to_string(hidden) + " more", encodings, cells.back());
+	}
+	return 0;
+}
+
+template <typename T, typename Count, typename Less>
+std::size_t Summarizer::arrangeColumn(std::vector<T>& items, Count count, Less less) const
+{
+	auto byFrequency = [&count, &less](const T& a, const T& b)
+	{
+		std::size_t countA = count(a);
+		std::size_t countB = count(b);
+		return countA != countB ? countA > countB : less(a, b);
+	};
+
+	// only the most frequent substrings need to be sorted, once they are partitioned from the rest
+	std::size_t hidden = 0;
+	if(layout.top != 0 && items.size() > layout.top)
+	{
+		std::nth_element(items.begin(), items.begin() + layout.top, items.end(), byFrequency);
+		hidden = items.size() - layout.top;
+		items.erase(items.begin() + layout.top, items.end());
+	}
+
+	if(layout.byFrequency)
+	{
+		std::sort(items.begin(), items.end(), byFrequency);
+	}
+	else
+	{
+		std::sort(items.begin(), items.end(), less);
+	}
+	return hidden;
+}
+
+int Summarizer::annotateCell(Cell& cell, std::size_t count, bool approximate, std::size_t filenames,
+                             ChunkArena& encodings)
+{
+	char number[32];
+	if(layout.counts == Layout::PERCENTAGES)
+	{
+		std::snprintf(number, sizeof(number), "%.1f%%", filenames == 0 ? 0.0 : 100.0 * count / filenames);
+	}
+	else
+	{
+		std::snprintf(number, sizeof(number), "%zu", count);
+	}
+
+	// the approximately-equal sign can only be printed in a utf-8 locale
+	const char* sign = !approximate ? "" : utf8Locale ? "\xE2\x89\x88" : "~";
+	std::string annotation = std::string(" (") + sign + number + ")";
+	Cell suffix;
+	int error = encodeText(annotation, encodings, suffix);
+	if(error != 0)
 	{
-        // transcode delimiters to utf-8, normalize them, and compute the boundaries between grapheme clusters
-		ingestString(_delimiters);
-		const char* graphemeBreaks = charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
-		const uint8_t* processedDelimiters = utf8BufferOuter.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
-		std::size_t processedDelimitersLength = utf8BufferOuter.getStringLength();
+		return error;
+	}
 
-		std::size_t first = 0;
-		std::size_t last = 1;
+	std::string joined(cell.bytes, cell.length);
+	joined.append(suffix.bytes, suffix.length);
+	ChunkArena::Handle copy = encodings.append((const uint8_t*) joined.data(), joined.size(), cell.width + suffix.width);
+	cell.bytes = (const char*) encodings.data(copy);
+	cell.length = copy.length;
+	cell.width = copy.width;
+	return 0;
+}
 
-        // count each grapheme cluster as a separate delimiter
-		for(; last < processedDelimitersLength; ++last)
+int Summarizer::encodeText(const std::string& text, ChunkArena& encodings, Cell& cell)
+{
+	int width = u8_width((const uint8_t*) text.data(), text.size(), localeCode);
+	ChunkArena::Handle copy = encodings.append((const uint8_t*) text.data(), text.size(), width);
+	return encodeCell(encodings.data(copy), copy.length, width, encodings, cell);
+}
+
+int Summarizer::encodeCell(const uint8_t* s, std::size_t n, int width, ChunkArena& encodings, Cell& cell)
+{
+	cell.width = width;
+
+	if(utf8Locale || (asciiCompatible && isPrintableAscii((const char*) s, n)))
+	{
+		// the substring is already encoded in the user's locale, so it is printed straight from where it is kept
+		cell.bytes = (const char*) s;
+		cell.length = n;
+		return 0;
+	}
+
+	char* result = converter -> fromUtf8(s,
+                                         n,
+                                         charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
+                                         charBuffer.giveCapacityGetStringLength());
+	int error = checkResult(result, charBuffer);
+	if(error != 0)
+	{
+		return error;
+	}
+
+	ChunkArena::Handle encoding = encodings.append((const uint8_t*) result, charBuffer.getStringLength(), width);
+	cell.bytes = (const char*) encodings.data(encoding);
+	cell.length = encoding.length;
+	return 0;
+}
+
+std::string Summarizer::describeSketch(const ColumnSketch& sketch) const
+{
+	// round the estimate to a few significant digits, since it is only accurate to within a few percent anyway
+	double estimate = sketch.estimateUnique();
+	const char* suffixes[] = {"", "K", "M", "G", "T"};
+	std::size_t suffix = 0;
+	while(estimate >= 999.5 && suffix + 1 < sizeof(suffixes) / sizeof(*suffixes))
+	{
+		estimate /= 1000;
+		++suffix;
+	}
+
+	char number[32];
+	std::snprintf(number, sizeof(number), suffix == 0 || estimate >= 9.95 ? "%.0f%s" : "%.1f%s", estimate,
+	              suffixes[suffix]);
+
+	// the approximately-equal sign can only be printed in a utf-8 locale
+	return std::string(utf8Locale ? "\xE2\x89\x88" : "~") + number + " distinct";
+}
+
+void Summarizer::sketchColumn(std::size_t index)
+{
+	ChunkColumn& column = pattern[index];
+	sketches[index].reset(new ColumnSketch(options.maxUnique));
+	renderedColumns[index].dirty = true;
+
+	const std::vector<ChunkArena::Handle>& handles = column.getHandles();
+	const std::vector<std::size_t>& counts = column.getCounts();
+	for(std::size_t i = 0; i < handles.size(); ++i)
+	{
+		sketches[index] -> insert(arena.data(handles[i]), handles[i].length, handles[i].width, counts[i]);
+	}
+	column.clear();
+}
+
+void Summarizer::addColumn()
+{
+	pattern.emplace_back(&arena);
+	sketches.emplace_back();
+	renderedColumns.emplace_back();
+}
+
+void Summarizer::insertColumn(std::size_t index)
+{
+	pattern.emplace(pattern.begin() + index, &arena);
+	sketches.emplace(sketches.begin() + index);
+	renderedColumns.emplace(renderedColumns.begin() + index);
+}
+
+int Summarizer::writeFully(int fd, const char* data, std::size_t size)
+{
+	// hand the whole buffer to the kernel in as few calls as possible, in slices small enough for any platform
+	const std::size_t SLICE_SIZE = 1 << 26;
+	std::vector<iovec> slices;
+	for(std::size_t offset = 0; offset < size; offset += SLICE_SIZE)
+	{
+		iovec slice;
+		slice.iov_base = (void*) (data + offset);
+		slice.iov_len = size - offset < SLICE_SIZE ? size - offset : SLICE_SIZE;
+		slices.push_back(slice);
+	}
+
+	std::size_t first = 0;
+	while(first < slices.size())
+	{
+		int count = slices.size() - first < IOV_MAX ? slices.size() - first : IOV_MAX;
+		ssize_t written = writev(fd, slices.data() + first, count);
+		if(written < 0)
 		{
-			if(graphemeBreaks[last])
+			if(errno == EINTR)
 			{
-				delimiters.emplace(processedDelimiters + first, last - first);
-				first = last;
+				continue;
 			}
+			return errno;
 		}
 
-		delimiters.emplace(processedDelimiters + first, processedDelimitersLength - first);
+		// skip past whatever was written, which may have ended partway through a slice
+		while(first < slices.size() && (std::size_t) written >= slices[first].iov_len)
+		{
+			written -= slices[first].iov_len;
+			++first;
+		}
+		if(first < slices.size())
+		{
+			slices[first].iov_base = (char*) slices[first].iov_base + written;
+			slices[first].iov_len -= written;
+		}
 	}
+	return 0;
 }
 
-void Summarizer::inputFilename(const char* filename)
+int Summarizer::ingestString(const char* filename, std::size_t length)
 {
-    // transcode filename to utf-8, normalize it, and compute the boundaries between grapheme clusters
-	ingestString(filename);
-	const char* graphemeBreaks = charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
-	const uint8_t* processedFilename = utf8BufferOuter.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
-	std::size_t processedFilenameLength = utf8BufferOuter.getStringLength();
+	if(asciiCompatible && isPrintableAscii(filename, length))
+	{
+		// the filename is already utf-8 and normalized, and each of its bytes is a separate grapheme cluster (so the
+		// grapheme breaks are not written out), so it is used as it is
+		asciiString = true;
+		processedString = (const uint8_t*) filename;
+		processedLength = length;
+		return 0;
+	}
 
-	patternIndex = 0;
-	std::size_t first = 0; // the start of the current substring under inspection, which has not yet been added to the pattern
-	std::size_t prev = 0; // the start of the current grapheme cluster under inspection, which has not yet been added to the pattern
-	std::size_t last = 1; // the end of the current grapheme cluster (and substring) under inspection, which has not yet been added to the pattern
+	asciiString = false;
+	uint8_t* result;
+	int error;
+
+    // transcode the filename from the user's locale into utf-8
+	{
+		StageTimer timer(stats, Stats::TRANSCODE);
+		result = converter -> toUtf8(filename, length,
+                                     _utf8BufferInner.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
+                                     _utf8BufferInner.giveCapacityGetStringLength());
+		error = checkResult(result, _utf8BufferInner);
+	}
+	if(error != 0)
+	{
+		return error;
+	}
 
-    // iterate over every byte in the processed filename...
-	for(; last < processedFilenameLength; ++last)
+    // normalize the utf-8 filename, unless it certainly is already, as nearly every filename is, in which case the
+    // transcoded filename is used as it is
 	{
-		if(graphemeBreaks[last])
+		StageTimer timer(stats, Stats::NORMALIZE);
+		processedString = _utf8BufferInner.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
+		processedLength = _utf8BufferInner.getStringLength();
+		if(!isQuickNfc(processedString, processedLength))
 		{
-            // we have reached the end of the current grapheme cluster
-
-			if(delimiters.empty() || delimiters.count(scratch.assign(processedFilename + prev, last - prev)))
+			result = u8_normalize(UNINORM_NFC, processedString, processedLength,
+			                      utf8BufferOuter.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
+			                      utf8BufferOuter.giveCapacityGetStringLength());
+			error = checkResult(result, utf8BufferOuter);
+			if(error != 0)
 			{
-                // either this grapheme cluster is a delimiter, or there are no explicit delimiters -- meaning every
-                // grapheme cluster is effectively treated like a delimiter. Either way, put this grapheme cluster
-                // [prev, last) into the next column of the pattern. But if there were any characters accumulating
-                // in [first, prev), due to them not being delimiters, add them to the next column first, and then add
-                // the current delimiter [prev, last) to the following column
-				if(first != prev)
-				{
-					insertInNextColumn(processedFilename, first, prev);
-				}
-				insertInNextColumn(processedFilename, prev, last);
-				//TODO: could encountering two delimiters in a row be presented better, e.g. create a new column right there for
-				// the second delimiter in a row and push the subsequent columns over by one? (make pattern a list)
-				first = last;
+				return error;
 			}
+			processedString = utf8BufferOuter.getWriteableStringDoesNotUpdateStringLengthOrCapacity();
+			processedLength = utf8BufferOuter.getStringLength();
+		}
+	}
 
-			prev = last;
-        }
+    // find the boundaries between the filename's grapheme clusters
+	StageTimer timer(stats, Stats::GRAPHEME_BREAKS);
+	error = reserveGraphemeBreaks(processedLength);
+	if(error != 0)
+	{
+		return error;
 	}
+#ifdef BUILTIN_SEGMENTER
+	// along with the display width of the filename up to each code point, so that the width of any of its substrings
+	// can be found without another pass over it
+	if(widthOffsets.size() <= processedLength)
+	{
+		widthOffsets.resize(processedLength + 1);
+	}
+	segmentGraphemes(processedString, processedLength, charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
+	                 widthOffsets.data(), cjkWidths);
+#else
+	u8_grapheme_breaks(processedString, processedLength, charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity());
+#endif
+	return 0;
+}
 
-    if(first != prev && delimiters.count(scratch.assign(processedFilename + prev, last - prev)))
-    {
-        // [prev, last) is a delimiter, so it is entered into the pattern separately after [first, prev)
-        insertInNextColumn(processedFilename, first, prev);
-        insertInNextColumn(processedFilename, prev, last);
-    }
-    else
+int Summarizer::reserveGraphemeBreaks(std::size_t length)
+{
+    // manually make sure that the char buffer into which the grapheme breaks will be recorded is big enough
+	if(charBuffer.getCapacity() < length)
+	{
+		char* graphemeBreaksResult = (char*) std::malloc(
+                sizeof(*(charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity())) * length
+                );
+		if(graphemeBreaksResult != nullptr)
+		{
+			*(charBuffer.giveCapacityGetStringLength()) = length;
+		}
+		return checkResult(graphemeBreaksResult, charBuffer);
+	}
+	return 0;
+}
+
+template <class T>
+int Summarizer::checkResult(T* result, SmartBuffer<T>& smartString)
+{
+	if(result != smartString.getWriteableStringDoesNotUpdateStringLengthOrCapacity())
+	{
+		//TODO: add filename logging for non-malloc errors, so can print "these filenames could not be processed:" at end
+		if(result == nullptr)
+		{
+			return fail(errno);
+		}
+
+		smartString.reset(result);
+		stats.count(Stats::BUFFER_RESETS);
+	}
+	return 0;
+}
+
+int Summarizer::fail(int error)
+{
+	if(status == 0)
+	{
+		status = error;
+	}
+	return error;
+}
+
+void Summarizer::insertInNextColumn(const uint8_t* str, std::size_t start, std::size_t end)
+{
+	insertChunk(str + start, end - start);
+	++patternIndex;
+}
+
+std::size_t Summarizer::insertChunk(const uint8_t* stringPointer, std::size_t length)
+{
+	if(pattern.size() == patternIndex)
+	{
+		// create a new column (set) in the pattern
+        addColumn();
+	}
+
+    StageTimer timer(stats, Stats::INSERT);
+
+    if(sketches[patternIndex])
     {
-        // [prev, last) is not a delimiter, so enter [first, last) into the pattern as a single substring
-        insertInNextColumn(processedFilename, first, last);
+        // the column has too many unique substrings to keep them all, so it is only counted in its sketch
+        ColumnSketch& sketch = *sketches[patternIndex];
+        ColumnSketch::Probe probe = sketch.probe(stringPointer, length);
+        if(probe.found)
+        {
+            sketch.addOccurrences(probe);
+            stats.count(Stats::DUPLICATE_SUBSTRINGS);
+        }
+        else
+        {
+            sketch.add(probe, stringPointer, length, substringWidth(stringPointer, length));
+            stats.count(Stats::NEW_SUBSTRINGS);
+        }
+        renderedColumns[patternIndex].dirty = true;
+        return SIZE_MAX;
     }
 
-	if(patternIndex < greatestCommonChunkIndex)
+    // look the substring up first, since most substrings are duplicates, and only compute the display width of (and
+    // store) a new one
+    ChunkColumn& column = pattern[patternIndex];
+    ChunkColumn::Probe probe = column.probe(stringPointer, length);
+	if(!probe.found)
 	{
-		greatestCommonChunkIndex = patternIndex;
+		int width = substringWidth(stringPointer, length);
+		column.add(probe, stringPointer, length, width);
+		renderedColumns[patternIndex].dirty = true;
+		stats.count(Stats::NEW_SUBSTRINGS);
+		if(options.maxUnique != 0 && column.size() > options.maxUnique)
+		{
+			sketchColumn(patternIndex);
+			return SIZE_MAX;
+		}
+		return column.size() - 1;
+	}
+
+	column.addOccurrences(probe);
+	stats.count(Stats::DUPLICATE_SUBSTRINGS);
+	if(layout.usesCounts())
+	{
+		renderedColumns[patternIndex].dirty = true;
 	}
+	return column.indexOf(probe);
 }
 
-void Summarizer::printSummary()
+void Summarizer::insertIngestedString()
 {
-	// scan for the "tallest column" (largest set) in the pattern. This will dictate the amount of rows in the output
-	const std::size_t patternSize = pattern.size();
-	std::size_t tallestColumnSize = 0;
+	if(options.alignBand == 0)
+	{
+		splitIngestedString<&Summarizer::insertInNextColumn>();
+		return;
+	}
 
-	for(std::size_t i = 0; i < patternSize; ++i)
+	alignedChunks.clear();
+	splitIngestedString<&Summarizer::collectChunk>();
+
+	// when every substring is already in the column at its own position, as most are in a regular pattern, no other
+	// alignment can score higher, so the table is not needed
+	std::size_t matched = 0;
 	{
-		/*TODO:
-		std::size_t currSize = pattern[i].size();
-		if(i > greatestCommonChunkIndex)
+		StageTimer timer(stats, Stats::ALIGN);
+		while(matched < alignedChunks.size() && matched < pattern.size() &&
+		      columnHas(alignedChunks[matched], matched))
 		{
-			//behavior for adding blank space under chunks going past the smallest common chunk length
-			++currSize;
+			++matched;
 		}
-		*/
-
-		if(pattern[i].size() > tallestColumnSize)
+	}
+	if(matched == alignedChunks.size())
+	{
+		patternIndex = 0;
+		for(auto it = alignedChunks.cbegin(); it != alignedChunks.cend(); ++it)
 		{
-			tallestColumnSize = pattern[i].size();
+			insertInNextColumn(alignedString, it -> start, it -> end);
 		}
 	}
+	else
+	{
+		alignCollectedChunks();
+	}
+	patternIndex = alignedChunks.size();
+}
 
-	std::vector<std::string> output(tallestColumnSize);
+int Summarizer::insertFilename(const char* filename, std::size_t length)
+{
+	// an empty filename still has a substring, which no prefix holds
+	if(!options.sharePrefixes || options.maxUnique != 0 || options.alignBand != 0 || length == 0)
+	{
+		int error = ingestString(filename, length);
+		if(error != 0)
+		{
+			return error;
+		}
+		insertIngestedString();
+		return 0;
+	}
 
-	// build up the pattern summary, one column at a time: re-encode the substrings in the user's locale and
-    // pad each substring such that each column has a consistent start and end column on screen
-	char* result;
-	for(std::size_t i=0; i < patternSize; ++i)
+	// find the longest marked prefix which is either the whole filename, or followed by a point where the filename
+	// can be split
+	const uint8_t* raw = (const uint8_t*) filename;
+	std::uint32_t prefixNode = PrefixTrie::ROOT;
+	std::size_t prefixLength = 0;
+	bool prefixAscii = true;
 	{
-		auto chunkIterator = pattern[i].crbegin();
-		auto chunkEnd = pattern[i].crend();
-		for(auto outputRowIterator = output.rbegin(); outputRowIterator != output.rend(); ++outputRowIterator)
+		StageTimer timer(stats, Stats::PREFIXES);
+		// once the trie is full, which keeps it small enough to stay in the cache, it only starts over if most bytes
+		// stop being found in it, e.g. once a sorted list of paths has moved on to other directories
+		if(prefixes.isFull() && checkedPrefixBytes >= PREFIX_CHECK_BYTES)
 		{
-			if(chunkIterator != chunkEnd)
+			if(2 * sharedPrefixBytes < checkedPrefixBytes)
 			{
-				result = u8_conv_to_encoding(localeCode,
-                                             iconveh_question_mark,
-                                             chunkIterator -> string.data(),
-                                             chunkIterator -> string.size(),
-                                             nullptr,
-                                             charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
-                                             charBuffer.giveCapacityGetStringLength());
-				checkResult(result, charBuffer); //TODO: technically not necessary?
-
-				outputRowIterator -> append(charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
-                                            charBuffer.getStringLength());
-				outputRowIterator -> append(highestWidths[i] - (chunkIterator -> width), ' ');
-
-                ++chunkIterator;
+				prefixes.clear();
 			}
-			else
+			checkedPrefixBytes = 0;
+			sharedPrefixBytes = 0;
+		}
+		prefixes.findMarks(raw, length, prefixMatches);
+		for(auto it = prefixMatches.crbegin(); it != prefixMatches.crend(); ++it)
+		{
+			if(it -> length == length || (it -> mark == PrefixTrie::SPLIT_MARK && canSplit(raw, length, it -> length)))
 			{
-				outputRowIterator -> append(highestWidths[i], ' ');
+				prefixNode = it -> node;
+				prefixLength = it -> length;
+				prefixAscii = it -> ascii;
+				break;
 			}
+		}
+		prefixes.getChunks(prefixNode, prefixChunks);
+		if(prefixes.isFull())
+		{
+			checkedPrefixBytes += length;
+			sharedPrefixBytes += prefixLength;
+		}
+	}
 
-			if(i != patternSize - 1)
+	// the rest of the filename is ingested before anything is counted, so that nothing is if it cannot be
+	if(prefixLength != length)
+	{
+		int error = ingestString(filename + prefixLength, length - prefixLength);
+		if(error != 0)
+		{
+			return error;
+		}
+	}
+
+	// the prefix's substrings are already in their columns, at the indices held by its marks
+	{
+		StageTimer timer(stats, Stats::INSERT);
+		for(std::size_t i = 0; i < prefixChunks.size(); ++i)
+		{
+			pattern[i].addOccurrencesAt(prefixChunks[i]);
+			if(layout.usesCounts())
 			{
-				outputRowIterator -> push_back(' '); //column divider
+				renderedColumns[i].dirty = true;
 			}
 		}
 	}
+	stats.count(Stats::DUPLICATE_SUBSTRINGS, prefixChunks.size());
+	stats.count(Stats::SHARED_PREFIX_BYTES, prefixLength);
+	if(prefixLength == length)
+	{
+		patternIndex = prefixChunks.size();
+		asciiString = prefixAscii;
+		return 0;
+	}
 
-	// print out the pattern summary, keeping in mind the column limit of the user's terminal
-	// TODO: keep in mind the column limit of the user's terminal. ulc_grapheme_breaks to know where to break this text?
-	for(auto it=output.begin(); it != output.end(); ++it)
+	// the points where the rest can be split are only added to the trie if its bytes are the ones it was split as,
+	// i.e. it needed neither transcoding nor normalization
+	bool record = !prefixes.isFull() &&
+	              (utf8Locale ? processedLength == length - prefixLength &&
+	                            std::memcmp(processedString, raw + prefixLength, processedLength) == 0 :
+	                            asciiString);
+	if(!record)
+	{
+		splitIngestedString<&Summarizer::insertInNextColumn>(prefixChunks.size());
+	}
+	else
 	{
-		printf("%s\n", it -> data());
+		recordedFilename = raw;
+		recordedLength = length;
+		recordedOffset = prefixLength;
+		recordedAsciiEnd = 0;
+		if(prefixAscii)
+		{
+			recordedAsciiEnd = prefixLength;
+			while(recordedAsciiEnd < length && raw[recordedAsciiEnd] >= 0x20 && raw[recordedAsciiEnd] <= 0x7E)
+			{
+				++recordedAsciiEnd;
+			}
+		}
+		recordedChunks.clear();
+		newMarks.clear();
+		splitIngestedString<&Summarizer::recordInNextColumn>(prefixChunks.size());
+
+		// the whole filename is marked too, if its end is not a point where it can be split already
+		if(newMarks.empty() || newMarks.back().length != length)
+		{
+			PrefixTrie::NewMark mark;
+			mark.length = length;
+			mark.mark = PrefixTrie::END_MARK;
+			mark.chunkEnd = recordedChunks.size();
+			mark.ascii = recordedAsciiEnd == length;
+			newMarks.push_back(mark);
+		}
+		StageTimer timer(stats, Stats::PREFIXES);
+		prefixes.addMarks(raw, prefixNode, prefixLength, newMarks, recordedChunks);
 	}
+	asciiString = asciiString && prefixAscii;
+	return 0;
 }
 
-void Summarizer::ingestString(const char* filename)
+bool Summarizer::canSplit(const uint8_t* filename, std::size_t length, std::size_t split) const
 {
-	uint8_t* result;
+	if(utf8Locale)
+	{
+		return isIndependentSplit(filename, length, split);
+	}
+	// a filename in another locale is only marked if it consists of printable ASCII characters, which are transcoded
+	// on their own, and always end a grapheme cluster before another one
+	return filename[split] >= 0x20 && filename[split] <= 0x7E;
+}
 
-    // transcode the filename from the user's locale into utf-8
-	result = u8_conv_from_encoding(localeCode, iconveh_question_mark, filename, std::strlen(filename), nullptr,
-                                   _utf8BufferInner.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
-                                   _utf8BufferInner.giveCapacityGetStringLength());
-	checkResult(result, _utf8BufferInner);
-
-    // normalize the utf-8 filename
-	result = u8_normalize(UNINORM_NFC, _utf8BufferInner.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
-                          _utf8BufferInner.getStringLength(),
-                          utf8BufferOuter.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
-                          utf8BufferOuter.giveCapacityGetStringLength());
-	checkResult(result, utf8BufferOuter);
+void Summarizer::recordInNextColumn(const uint8_t* str, std::size_t start, std::size_t end)
+{
+	recordedChunks.push_back(insertChunk(str + start, end - start));
+	++patternIndex;
 
-    // manually make sure that the char buffer into which the grapheme breaks will be recorded is big enough
-    std::size_t outerStringLength = utf8BufferOuter.getStringLength();
-	*(_utf8BufferInner.giveCapacityGetStringLength()) = outerStringLength;
-	if(_utf8BufferInner.getCapacity() < outerStringLength)
+	// every filename with the same bytes up to here is split here too, if the substring is a delimiter (or every
+	// grapheme cluster is a substring) and the filename can be split here, so that the delimiter is still a grapheme
+	// cluster of its own
+	std::size_t split = recordedOffset + end;
+	if((splitMode == NO_DELIMITERS || isDelimiter(str + start, end - start)) &&
+	   (split == recordedLength || canSplit(recordedFilename, recordedLength, split)))
 	{
-		char* graphemeBreaksResult = (char*) std::malloc(
-                sizeof(*(charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity())) * outerStringLength
-                );
-		checkResult(graphemeBreaksResult, charBuffer);
+		PrefixTrie::NewMark mark;
+		mark.length = split;
+		mark.mark = PrefixTrie::SPLIT_MARK;
+		mark.chunkEnd = recordedChunks.size();
+		mark.ascii = split <= recordedAsciiEnd;
+		newMarks.push_back(mark);
 	}
+}
 
-    // find the boundaries between the filename's grapheme clusters
-	u8_grapheme_breaks(utf8BufferOuter.getWriteableStringDoesNotUpdateStringLengthOrCapacity(),
-                       outerStringLength,
-                       charBuffer.getWriteableStringDoesNotUpdateStringLengthOrCapacity());
+void Summarizer::collectChunk(const uint8_t* str, std::size_t start, std::size_t end)
+{
+	AlignedChunk chunk;
+	chunk.start = start;
+	chunk.end = end;
+	chunk.hash = ChunkColumn::hash(str + start, end - start);
+	alignedChunks.push_back(chunk);
+	alignedString = str;
+	++patternIndex;
 }
 
-template <class T>
-void Summarizer::checkResult(T* result, SmartBuffer<T>& smartString)
+void Summarizer::alignCollectedChunks()
 {
-	if(result != smartString.getWriteableStringDoesNotUpdateStringLengthOrCapacity())
+	// cell (i, j) of the table holds the best score of aligning the first i substrings with the first j columns. Only
+	// the cells with j - i between -band and band are kept, in rows of 2 * band + 1 cells
+	const std::size_t chunkCount = alignedChunks.size();
+	const std::size_t columnCount = pattern.size();
+	const std::size_t lastColumn = std::max(columnCount, chunkCount);
+	const std::size_t band = options.alignBand;
+	const std::size_t rowSize = 2 * band + 1;
+	const int UNREACHED = INT_MIN / 2;
 	{
-		//TODO: add filename logging for non-malloc errors, so can print "these filenames could not be processed:" at end
-		if(result == nullptr)
+		StageTimer timer(stats, Stats::ALIGN);
+		alignScores.assign((chunkCount + 1) * rowSize, UNREACHED);
+		alignMoves.resize((chunkCount + 1) * rowSize);
+		alignScores[band] = 0;
+		for(std::size_t i = 0; i <= chunkCount; ++i)
+		{
+			std::size_t firstColumn = i > band ? i - band : 0;
+			std::size_t endColumn = std::min(i + band, lastColumn) + 1;
+			for(std::size_t j = firstColumn; j < endColumn; ++j)
+			{
+				std::size_t cell = i * rowSize + j + band - i;
+				int best = alignScores[cell];
+				AlignMove move = PLACE;
+
+				// the substring goes in column j - 1, which, past the end of the pattern, is a new one
+				if(i > 0 && j > 0 && alignScores[cell - rowSize] != UNREACHED)
+				{
+					int score = alignScores[cell - rowSize] + placementScore(alignedChunks[i - 1], j - 1);
+					if(score > best)
+					{
+						best = score;
+						move = PLACE;
+					}
+				}
+				// column j - 1 is left out. New columns are only added for substrings, so none can be left out. On a
+				// tie, the columns left out are the last ones, so that the substrings of a shorter filename go in
+				// the same columns as the first substrings of the longer ones
+				if(j > 0 && j <= columnCount && j + band > i && alignScores[cell - 1] != UNREACHED &&
+				   alignScores[cell - 1] - SKIP_COST >= best)
+				{
+					best = alignScores[cell - 1] - SKIP_COST;
+					move = SKIP;
+				}
+				// the substring goes in a new column in front of column j
+				if(i > 0 && j < columnCount && j < i + band && alignScores[cell - rowSize + 1] != UNREACHED &&
+				   alignScores[cell - rowSize + 1] - INSERT_COST > best)
+				{
+					best = alignScores[cell - rowSize + 1] - INSERT_COST;
+					move = INSERT;
+				}
+
+				alignScores[cell] = best;
+				alignMoves[cell] = move;
+			}
+		}
+	}
+
+	// the filename may end before the last columns of the pattern, which it then has no substring in
+	std::size_t i = chunkCount;
+	std::size_t j = chunkCount > band ? chunkCount - band : 0;
+	for(std::size_t column = j; column <= std::min(chunkCount + band, lastColumn); ++column)
+	{
+		if(alignScores[i * rowSize + column + band - i] > alignScores[i * rowSize + j + band - i])
 		{
-			std::perror(nullptr);
-			std::exit(EXIT_FAILURE);
+			j = column;
 		}
+	}
 
-		smartString.reset(result);
+	// follow the best moves back from the end of the table, noting where each substring goes
+	while(i > 0)
+	{
+		AlignMove move = alignMoves[i * rowSize + j + band - i];
+		if(move == SKIP)
+		{
+			--j;
+			continue;
+		}
+		AlignedChunk& chunk = alignedChunks[--i];
+		chunk.inserted = move == INSERT;
+		chunk.column = move == INSERT ? j : --j;
+	}
+
+	// the columns inserted for earlier substrings move all the later columns along
+	std::size_t insertedColumns = 0;
+	for(auto it = alignedChunks.cbegin(); it != alignedChunks.cend(); ++it)
+	{
+		patternIndex = it -> column + insertedColumns;
+		if(it -> inserted)
+		{
+			insertColumn(patternIndex);
+			++insertedColumns;
+		}
+		insertInNextColumn(alignedString, it -> start, it -> end);
 	}
 }
 
-void Summarizer::insertInNextColumn(const uint8_t* str, std::size_t start, std::size_t end)
+int Summarizer::placementScore(const AlignedChunk& chunk, std::size_t index) const
 {
-	if(pattern.size() == patternIndex)
+	if(index >= pattern.size())
 	{
-		// create a new column (set) in the pattern
-        pattern.emplace_back(displayWidthStringComp);
-		highestWidths.push_back(0);
+		return -NEW_COLUMN_COST;
+	}
+	if(columnHas(chunk, index))
+	{
+		return MATCH_SCORE;
 	}
+	// a substring fits in among many others better than it does next to a few which are always the same
+	return sketches[index] || pattern[index].size() > VARIED_COLUMN_SIZE ? -VARIED_MISMATCH_COST : -MISMATCH_COST;
+}
+
+bool Summarizer::columnHas(const AlignedChunk& chunk, std::size_t index) const
+{
+	const uint8_t* s = alignedString + chunk.start;
+	std::size_t n = chunk.end - chunk.start;
+	return sketches[index] ? sketches[index] -> probe(s, n).found : pattern[index].contains(s, n, chunk.hash);
+}
 
-    const uint8_t* stringPointer = str + start;
-    std::size_t length = end - start;
-    int width = u8_width(stringPointer, length, localeCode);
-	pattern[patternIndex].emplace(stringPointer, length, width);
-	if(width > highestWidths[patternIndex])
+int Summarizer::substringWidth(const uint8_t* s, std::size_t n)
+{
+	StageTimer timer(stats, Stats::WIDTH);
+#ifdef BUILTIN_SEGMENTER
+	std::size_t start = s - processedString;
+	return asciiString ? (int) n : widthOffsets[start + n] - widthOffsets[start];
+#else
+	return asciiString ? (int) n : u8_width(s, n, localeCode);
+#endif
+}
+
+bool Summarizer::isValidSavedChunk(const uint8_t* s, std::size_t n, std::uint64_t width) const
+{
+	// u8_width stops at a NUL character, which no filename has anyway
+	return s != nullptr && u8_check(s, n) == nullptr && std::memchr(s, '\0', n) == nullptr &&
+	       width == (std::uint64_t) u8_width(s, n, localeCode);
+}
+
+void Summarizer::removeFromNextColumn(const uint8_t* str, std::size_t start, std::size_t end)
+{
+	if(patternIndex < pattern.size() && !sketches[patternIndex])
 	{
-        highestWidths[patternIndex] = width;
+		ChunkColumn& column = pattern[patternIndex];
+		ChunkColumn::Probe probe = column.probe(str + start, end - start);
+		if(probe.found)
+		{
+			bool removed = column.removeOccurrences(probe);
+			if(removed || layout.usesCounts())
+			{
+				renderedColumns[patternIndex].dirty = true;
+			}
+			if(removed)
+			{
+				// the last substring of the set has taken the removed one's index, which prefixes may hold
+				prefixes.clear();
+			}
+		}
 	}
 
 	++patternIndex;
 }
 
+void Summarizer::compactArena()
+{
+	// every copy is made before any set is changed, so that running out of memory leaves the pattern as it was
+	ChunkArena compacted;
+	std::vector<std::vector<ChunkArena::Handle>> copies(pattern.size());
+	for(std::size_t i = 0; i < pattern.size(); ++i)
+	{
+		pattern[i].copyChunks(compacted, copies[i]);
+	}
+	for(std::size_t i = 0; i < pattern.size(); ++i)
+	{
+		pattern[i].replaceHandles(copies[i]);
+	}
+	arena.swap(compacted);
+
+	// the cells of rendered sets which did not need to be re-encoded point into the old arena, which is freed now
+	for(auto it = renderedColumns.begin(); it != renderedColumns.end(); ++it)
+	{
+		it -> dirty = true;
+	}
+}
+
 template <class T>
 Summarizer::SmartBuffer<T>::SmartBuffer() :
         stringLength(0),
@@ -272,8 +1653,7 @@ Summarizer::SmartBuffer<T>::SmartBuffer() :
 	string = (T*) std::malloc(sizeof(*string) * capacity);
 	if(string == nullptr)
     {
-        std::perror(nullptr);
-        std::exit(EXIT_FAILURE);
+        throw std::bad_alloc();
     }
 }
 
@@ -292,8 +1672,3 @@ void Summarizer::SmartBuffer<T>::reset(T* other)
     // other's capacity will be the same as the length of its string, since other was newly allocated by libunistring
 	capacity = stringLength;
 }
-
-Summarizer::DisplayWidthString::DisplayWidthString(const uint8_t* s, std::size_t n, int width) :
-	string(s, n),
-	width(width)
-{}
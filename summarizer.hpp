@@ -23,10 +23,18 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
 #include <vector>
-#include <set>
 #include <string>
 #include <unitypes.h>
+#include "chunkarena.hpp"
+#include "chunkcolumn.hpp"
+#include "columnsketch.hpp"
+#include "bytescan.hpp"
+#include "converter.hpp"
+#include "prefixtrie.hpp"
+#include "statefile.hpp"
+#include "stats.hpp"
 
 #ifndef SUMMARIZER_H
 #define SUMMARIZER_H
@@ -34,36 +42,236 @@
 /* Only the public methods of class Summarizer are intended to be public API for any client code. */
 
 /*
- * Computes and prints the pattern of a list of filenames. Takes into account the user's locale, respects
+ * Computes and prints the pattern of a list of filenames. Takes into account the current locale, respects
  * user-perceived characters (a.k.a. grapheme clusters) as defined by https://unicode.org/reports/tr29/ , and
  * prior to comparing characters, performs text normalization as defined by https://unicode.org/reports/tr15/ .
+ *
+ * A Summarizer never halts the program: a method which fails returns the errno value describing why, and the first
+ * such failure is kept by Summarizer::getStatus. Running out of memory while growing the pattern itself throws
+ * std::bad_alloc, like the standard containers it is kept in.
  */
 class Summarizer
 {
 	public:
         /*
-         * Constructs a Summarizer object.
+         * Receives the columns of the pattern, and the unique substrings in each one, from Summarizer::visitPattern.
+         */
+        class PatternVisitor
+        {
+            public:
+                virtual ~PatternVisitor() {}
+
+                /*
+                 * Called for each column of the pattern in turn, before its substrings.
+                 * @param index the index of the column in the pattern
+                 * @param uniqueCount the number of unique substrings in the column
+                 * @param approximate whether the column was replaced by a sketch, in which case uniqueCount is an
+                 *        estimate, and only the column's most frequent substrings are visited, with counts which may
+                 *        be too high
+                 */
+                virtual void visitColumn(std::size_t index, double uniqueCount, bool approximate) = 0;
+
+                /*
+                 * Called for each unique substring of the column last passed to PatternVisitor::visitColumn, in no
+                 * particular order.
+                 * @param bytes the substring, normalized and encoded in utf-8. Only valid during the call
+                 * @param length the number of bytes in the substring
+                 * @param width the number of columns required to display the substring on a terminal
+                 * @param count the number of ingested filenames which have the substring in this column
+                 */
+                virtual void visitChunk(const uint8_t* bytes, std::size_t length, int width, std::size_t count) = 0;
+        };
+
+        /*
+         * Settings which change how the pattern is computed, beyond the delimiters.
+         */
+        struct Options
+        {
+            /* the most unique substrings kept exactly in any column of the pattern. A column with more unique
+               substrings is summarized by a fixed-size ColumnSketch instead. Zero means that there is no limit */
+            std::size_t maxUnique;
+
+            /* how far the column of a filename's substring may be from the substring's position in the filename. When
+               not zero, each filename's substrings are aligned against the columns of the pattern so far, so that
+               an extra or missing substring does not shift all of the ones after it into the wrong columns; new
+               columns are inserted for substrings which fit none. Zero means that the Nth substring always goes in
+               the Nth column. Filenames cannot be removed from a pattern computed with alignment, and its columns
+               no longer match up with those of another pattern for Summarizer::merge */
+            std::size_t alignBand;
+
+            /* whether the substrings of filenames' prefixes are remembered in a PrefixTrie, so that only the part of a
+               filename after the longest prefix it shares with an earlier one is transcoded, normalized, segmented
+               and looked up. Does not change the pattern. Has no effect together with maxUnique or alignBand, whose
+               columns do not keep a substring at the same index */
+            bool sharePrefixes;
+
+            Options() : maxUnique(0), alignBand(0), sharePrefixes(false) {}
+        };
+
+        /*
+         * Settings which change how Summarizer::printSummary and Summarizer::renderSummary lay out the pattern, but not
+         * the pattern itself.
+         */
+        struct Layout
+        {
+            /* what is printed beside each substring */
+            enum Counts
+            {
+                NO_COUNTS, /* nothing */
+                COUNTS, /* the number of filenames which have the substring in that column */
+                PERCENTAGES /* the same, as a percentage of all the filenames */
+            };
+            Counts counts;
+
+            /* whether each column's substrings are ordered by their number of filenames, most first (and then
+               lexicographically), instead of lexicographically */
+            bool byFrequency;
+
+            /* the most substrings printed in any column, which are then the ones with the most filenames, followed by
+               the number of substrings left out. Zero means that there is no limit */
+            std::size_t top;
+
+            Layout() : counts(NO_COUNTS), byFrequency(false), top(0) {}
+
+            /* @return whether the layout depends on the number of filenames which have each substring */
+            bool usesCounts() const { return counts != NO_COUNTS || byFrequency || top != 0; }
+        };
+
+        /*
+         * Constructs a Summarizer object. If the delimiters cannot be converted to utf-8, Summarizer::getStatus
+         * says why. Filenames and delimiters are taken to be in the encoding of the locale that is current at this
+         * point, e.g. after setlocale(LC_ALL, ""), which is the caller's to set; the locale is never changed.
          * @param _delimiters the user-perceived characters around which filenames will be split. If _delimiters
          *        contains multiple user-perceived characters e.g. "ab", then 'a' and 'b' are separate delimiters;
          *        the string "ab" is not a delimiter. Can be NULL to indicate no delimiters in particular, in which
          *        case the filenames are all broken down into individual user-perceived characters
+         * @param _options the settings for computing the pattern
          */
-		Summarizer(const char* _delimiters);
+		Summarizer(const char* _delimiters, const Options& _options = Options());
 
         /*
          * Converts the supplied filename into utf-8, normalizes it, and splits it into substrings in accordance with
          * the user-determined delimiters. Adds these substrings into the running computation of the overall pattern
          * of filenames.
          * @param filename the filename to be ingested into the pattern
+         * @return 0, or the errno value describing why the filename could not be converted, in which case it is
+         *         left out of the pattern
+         */
+		int inputFilename(const char* filename);
+
+        /*
+         * Same as Summarizer::inputFilename(const char*), but for a filename which is not necessarily NUL-terminated.
+         * @param filename the filename to be ingested into the pattern
+         * @param length the number of bytes in filename
+         * @return 0, or the errno value describing why the filename could not be converted, in which case it is
+         *         left out of the pattern
+         */
+		int inputFilename(const char* filename, std::size_t length);
+
+        /*
+         * Same as calling Summarizer::inputFilename(const char*) on each filename in turn, but the bookkeeping done
+         * once per filename is done once for the whole batch instead.
+         * @param filenames the NUL-terminated filenames to be ingested into the pattern
+         * @param count the number of filenames
+         * @return 0, or the errno value describing why the first filename which could not be converted failed.
+         *         Only the filenames which failed are left out of the pattern
+         */
+		int inputFilenames(const char* const* filenames, std::size_t count);
+
+        /*
+         * Takes a filename which was ingested before back out of the pattern, as if it had never been ingested.
+         * Substrings which no other filename has are taken out of their sets, and sets which no filename reaches any
+         * more are taken off the end of the pattern. Sets which have been replaced by a sketch keep counting the
+         * filename's substrings, though.
+         * @param filename the filename to take out of the pattern
+         * @param length the number of bytes in filename
+         * @return 0, or the errno value describing why the filename could not be converted, or ENOTSUP if the
+         *         filenames are being aligned, in which case the pattern is left unchanged
+         */
+		int removeFilename(const char* filename, std::size_t length);
+
+        /*
+         * Adds the pattern of every filename ingested by another Summarizer into this one's pattern, exactly as if
+         * this Summarizer had ingested those filenames itself. Both Summarizers must use the same delimiters and options.
+         * The other Summarizer's status is taken on too, if this one has not failed yet.
+         * @param other the Summarizer whose pattern is added to this one's. Left unchanged
          */
-		void inputFilename(const char* filename);
+		void merge(const Summarizer& other);
 
         /*
          * Prints the pattern of all the filenames that have been supplied. The Nth substrings of every filename are
          * put together in a group, resulting in N groups. Then the unique substrings within each group are
          * printed in a vertical column, with all N columns appearing side-by-side on the user's terminal.
+         * @return 0, or the errno value of the first failure of this Summarizer, whether while printing or before,
+         *         in which case nothing (or only part of the summary) is printed
+         */
+		int printSummary();
+
+        /*
+         * Same as Summarizer::printSummary, but writes the summary into a buffer instead of printing it. Only the
+         * columns of the pattern which changed since the summary was last rendered are sorted and encoded again, so
+         * that a summary which is kept up to date can be redrawn cheaply.
+         * @param output set to the summary, encoded in the user's locale
+         * @return 0, or the errno value of the first failure of this Summarizer, whether while rendering or before,
+         *         in which case output is empty
+         */
+		int renderSummary(std::vector<char>& output);
+
+        /*
+         * Changes how Summarizer::printSummary and Summarizer::renderSummary lay out the pattern from then on.
+         * @param _layout the new layout
+         */
+		void setLayout(const Layout& _layout);
+
+        /*
+         * Passes every column of the pattern and the unique substrings in it to a visitor, without sorting, encoding
+         * or laying out any of them, so that client code can use the pattern without the cost of rendering it.
+         * @param visitor the visitor to pass the columns and substrings to
+         */
+		void visitPattern(PatternVisitor& visitor) const;
+
+        /*
+         * @return 0 if nothing this Summarizer has done has failed; otherwise, the errno value of the first failure
+         */
+		int getStatus() const { return status; }
+
+        /*
+         * Writes all of a buffer to a file descriptor with writev, retrying after partial writes.
+         * @param fd the file descriptor to write to
+         * @param data the buffer to write
+         * @param size the number of bytes in data
+         * @return 0, or the errno value describing why the buffer could not be written in full
+         */
+		static int writeFully(int fd, const char* data, std::size_t size);
+
+        /*
+         * @return the times and counts of everything this Summarizer has done, for Summarizer::printStats
+         */
+		Stats& getStats() { return stats; }
+
+        /*
+         * Prints the times and counts of everything this Summarizer has done, and the number of unique substrings in
+         * each column of the pattern, to stderr.
+         * @param json whether to print a JSON object instead of a table
+         */
+		void printStats(bool json) const;
+
+        /*
+         * Writes out the pattern, along with the locale, delimiters and options it was computed with, so that it can
+         * be restored by Summarizer::deserialize. Sets which have been replaced by a sketch are written out as the
+         * sketch.
+         * @param writer where to write the pattern to
+         */
+		void serialize(StateWriter& writer) const;
+
+        /*
+         * Restores a pattern written out by Summarizer::serialize, in place of the pattern of everything ingested so
+         * far, which should be nothing.
+         * @param reader where to read the pattern from
+         * @return true if the pattern was restored; false if it is malformed, or was computed in another locale or
+         *         with other delimiters or options, in which case nothing is restored
          */
-		void printSummary();
+		bool deserialize(StateReader& reader);
 	private:
 		typedef std::basic_string<uint8_t> uint8_string;
 
@@ -78,7 +286,7 @@ class Summarizer
 			public:
                 /*
                  * Construct a SmartBuffer object. Allocates a character buffer with a size of UTF8_FILENAME_MAX.
-                 * Halts program if there is an error in buffer allocation.
+                 * Throws std::bad_alloc if there is an error in buffer allocation.
                  */
 				SmartBuffer();
 
@@ -129,74 +337,372 @@ class Summarizer
 				std::size_t* stringLengthPointer; /* pointer to stringLength. Used as an in/out parameter */
 		};
 
-        /*
-         * Holds a std::string of utf-8 characters, along with the number of columns that string takes up on a terminal
-         * screen (assuming a monospace font).
-         */
-		struct DisplayWidthString
-		{
-            /*
-             * Construct a DisplayWidthString object.
-             * @param s the source buffer of uint8_t from which to construct the std::string
-             * @param n the number of uint8_t characters to include in the std::string, starting from the position
-             *        pointed to by s
-             * @param width the number of columns required to display the string on a terminal
-             */
-			DisplayWidthString(const uint8_t* s, std::size_t n, int width);
-
-			const uint8_string string;
-			const int width;
-		};
-
-        /*
-         * A comparison function for objects of type DisplayWidthString. Compares the std::strings held by each object.
-         * @param lhs the first DisplayWidthString object
-         * @param rhs the second DisplayWidthString object
-         * @return true if lhs's std::string comes lexicographically before rhs's std::string; false otherwise.
-         */
-        static bool displayWidthStringComp (const DisplayWidthString& lhs, const DisplayWidthString& rhs)
-        {
-            return lhs.string < rhs.string;
-        }
-
         /* tracks the largest common index of substrings ("chunk") that get inserted into the pattern, over all filenames */
 		std::size_t greatestCommonChunkIndex;
 
         /* keeps track of the next set in the pattern to insert filename substrings into, as a filename is being ingested */
         std::size_t patternIndex;
 
+        /* holds the bytes of every substring in the pattern */
+		ChunkArena arena;
+
         /* sequence of N sets, each one holding the unique Nth substrings of all ingested filenames */
-		std::vector<std::set<DisplayWidthString, decltype(displayWidthStringComp)*>> pattern; //TODO: make std::forward_list
+		std::vector<ChunkColumn> pattern; //TODO: make std::forward_list
 
-        /* tracks the highest display width of any substring in a set, for all sets in pattern.
-           Used to pad a set's substrings with spaces when printing out the pattern */
-		std::vector<int> highestWidths;
+        /* for each set in pattern, the sketch which replaced it once it held more than options.maxUnique substrings,
+           or null while the set is still exact */
+		std::vector<std::unique_ptr<ColumnSketch>> sketches;
+
+        /* the number of ingested filenames which were split into each number of substrings, so that
+           greatestCommonChunkIndex can be found again once filenames are removed */
+		std::vector<std::size_t> filenamesByChunkCount;
+
+        Options options; /* the settings for computing the pattern */
+        Layout layout; /* the settings for printing the pattern */
+        Stats stats; /* the time spent in each stage of ingesting and printing, and counts of what happened */
+        int status; /* the errno value of the first failure of any method, or 0 */
 
         int colLimit; /* the number of columns in the user's terminal */
-        std::set<uint8_string> delimiters; /* normalized, utf-8 encoded version of the delimiters passed into the Summarizer object*/
-        uint8_string scratch; /* extra std::string used in determining when a delimiter is encountered in filenames */
+        /* the ways of splitting filenames into substrings, each with its own specialization of Summarizer::splitString */
+        enum SplitMode
+        {
+            NO_DELIMITERS, /* no delimiters were passed into the Summarizer object: every grapheme cluster is a substring */
+            BYTE_DELIMITERS, /* every delimiter is a single byte, i.e. an ASCII character */
+            GRAPHEME_DELIMITERS /* some delimiter takes up more than one byte */
+        };
+
+        SplitMode splitMode; /* the way that filenames are split into substrings, depending on the delimiters */
+        std::vector<uint8_string> delimiters; /* normalized, utf-8 encoded version of the delimiters passed into the Summarizer object*/
+        ByteSet delimiterBytes; /* the first byte of every delimiter, for skipping over bytes that can't start a delimiter */
 		const char* localeCode; /* libunistring-recognized code for the user's locale */
-		SmartBuffer<uint8_t> _utf8BufferInner; /* scratch buffer used when ingesting filenames */
-		SmartBuffer<uint8_t> utf8BufferOuter; /* buffer that contains utf-8 encoded, normalized filenames */
+		std::unique_ptr<LocaleConverter> converter; /* transcodes between the user's locale and utf-8 */
+		bool utf8Locale; /* whether the user's locale uses utf-8, so that no transcoding is needed to print substrings */
+		bool asciiCompatible; /* whether the printable ASCII characters are encoded the same in the user's locale as in utf-8 */
+		bool asciiString; /* whether the string most recently ingested consisted only of printable ASCII characters */
+		const uint8_t* processedString; /* the utf-8 encoded, normalized version of the string most recently ingested */
+		std::size_t processedLength; /* the length of processedString */
+		SmartBuffer<uint8_t> _utf8BufferInner; /* buffer that contains utf-8 encoded filenames, which are used from it as they are if already normalized */
+		SmartBuffer<uint8_t> utf8BufferOuter; /* buffer that contains utf-8 encoded filenames which had to be normalized */
 		SmartBuffer<char> charBuffer; /* used to locate grapheme clusters in filenames, and to encode the pattern's substrings in the user's locale */
+		std::vector<int> widthOffsets; /* with the built-in segmenter, the display width of processedString up to each of its code points */
+		bool cjkWidths; /* whether the user's locale counts the characters which are wide in CJK encodings as 2 columns wide */
 
         /*
          * Helper function for Summarizer::ingestFilename.
-         * Calls the libunistring functions to transcode and normalize the filename.
+         * Calls the libunistring functions to transcode and normalize the filename, and find its grapheme clusters.
+         * Normalization is skipped for filenames which pass isQuickNfc, i.e. which are certainly normalized already.
+         * The result is pointed to by processedString, and the grapheme breaks are written to charBuffer. When built
+         * with BUILTIN_SEGMENTER defined, segmentGraphemes finds the grapheme clusters instead, and the display widths
+         * of processedString's substrings along with them, into widthOffsets.
+         * Filenames of only printable ASCII characters skip the libunistring functions, when asciiCompatible is set.
+         * @param filename the filename to be ingested into the pattern
+         * @param length the number of bytes in filename
+         * @return 0, or the errno value describing why a libunistring function failed, as recorded in status
+         */
+		int ingestString(const char* filename, std::size_t length);
+
+        /* a method which is passed each substring of a filename in turn, along with the filename it is part of */
+        typedef void (Summarizer::*SubstringVisitor)(const uint8_t* str, std::size_t start, std::size_t end);
+
+        /*
+         * Helper function for Summarizer::inputFilename, Summarizer::inputFilenames and Summarizer::removeFilename.
+         * Splits the string most recently ingested into substrings with the specialization of Summarizer::splitString
+         * that applies to it, and counts the substrings in patternIndex.
+         * @tparam visit the method to pass each substring to, which must increment patternIndex
+         * @param firstIndex the column of the string's first substring, when the string is the rest of a filename
+         *        whose first substrings are already known
+         */
+		template <SubstringVisitor visit> void splitIngestedString(std::size_t firstIndex = 0);
+
+        /*
+         * Helper function for Summarizer::splitIngestedString.
+         * Splits the string most recently ingested into substrings around the delimiters, and passes each one to visit
+         * in turn. Specialized at compile time for each way of splitting, and for strings made up of only printable
+         * ASCII characters, so that no checks that cannot apply are made for every character.
+         * @tparam mode the way of splitting the string, which must be splitMode
+         * @tparam ascii whether the string consists only of printable ASCII characters, in which case every byte is
+         *         a grapheme cluster of its own, and graphemeBreaks is not looked at
+         * @tparam visit the method to pass each substring to
+         * @param graphemeBreaks the boundaries between the string's grapheme clusters, as found by u8_grapheme_breaks
+         */
+		template <SplitMode mode, bool ascii, SubstringVisitor visit> void splitString(const char* graphemeBreaks);
+
+        /*
+         * Helper function for Summarizer::inputFilename and Summarizer::inputFilenames.
+         * Adds the substrings of the string most recently ingested to the pattern, either in the column matching the
+         * position of each one, or in the columns they are aligned with, and sets patternIndex to their number.
+         */
+		void insertIngestedString();
+
+        /*
+         * Helper function for Summarizer::inputFilename and Summarizer::inputFilenames.
+         * Ingests a filename and adds its substrings to the pattern, like Summarizer::ingestString followed by
+         * Summarizer::insertIngestedString, and sets patternIndex to their number and asciiString as for the whole
+         * filename. When options.sharePrefixes applies, the substrings of the longest prefix that the filename shares
+         * with an earlier one at a point where it can be split are taken from prefixes instead, only the rest of the
+         * filename is ingested, and the points where the rest can be split are added to prefixes.
          * @param filename the filename to be ingested into the pattern
+         * @param length the number of bytes in filename
+         * @return 0, or the errno value describing why the filename could not be converted, in which case it is
+         *         left out of the pattern
+         */
+		int insertFilename(const char* filename, std::size_t length);
+
+        /*
+         * Helper function for Summarizer::insertFilename.
+         * Checks whether a filename, in the user's locale, can be cut in two at a point without changing how it is
+         * transcoded, normalized and segmented on either side of it: see isIndependentSplit. In other locales than
+         * utf-8, that is only certain where a printable ASCII character follows the point.
+         * @param filename the bytes of the filename
+         * @param length the number of bytes in filename
+         * @param split the number of bytes before the point, from 1 to length - 1
+         * @return whether the filename can be cut in two there
          */
-		void ingestString(const char* filename);
+		bool canSplit(const uint8_t* filename, std::size_t length, std::size_t split) const;
+
+        /*
+         * Helper function for Summarizer::insertFilename.
+         * Same as Summarizer::insertInNextColumn, but also notes the substring's index in its column in recordedChunks,
+         * and, if a filename can be split after it, adds a mark there to newMarks.
+         * @param str the character buffer to take a substring of
+         * @param start where the substring in str begins (inclusive)
+         * @param end where the substring in str ends (exclusive)
+         */
+		void recordInNextColumn(const uint8_t* str, std::size_t start, std::size_t end);
+
+        /* the number of bytes of filenames looked up in a full PrefixTrie after which it is checked whether enough of
+           them were found in it to keep it */
+        static const std::size_t PREFIX_CHECK_BYTES = 1 << 20;
+
+        /* the number of bytes of removed substrings in the arena below which it is never compacted, so that a small
+           pattern is not copied over and over */
+        static const std::size_t MIN_COMPACTED_BYTES = 1 << 20;
+
+        /* the raw bytes of ingested filenames, with the substrings of their prefixes, if options.sharePrefixes applies */
+        PrefixTrie prefixes;
+        std::size_t checkedPrefixBytes; /* the bytes of filenames looked up since prefixes was full or last checked */
+        std::size_t sharedPrefixBytes; /* how many of those bytes were in prefixes found in it */
+        std::vector<PrefixTrie::Match> prefixMatches; /* the marks on the path of the filename being ingested */
+        std::vector<std::uint32_t> prefixChunks; /* the column indices of the substrings of the filename's prefix */
+        std::vector<std::uint32_t> recordedChunks; /* the column indices of the substrings after the prefix */
+        std::vector<PrefixTrie::NewMark> newMarks; /* the points after the prefix where the filename can be split */
+        const uint8_t* recordedFilename; /* the raw bytes of the filename whose substrings are being recorded */
+        std::size_t recordedLength; /* the number of bytes in recordedFilename */
+        std::size_t recordedOffset; /* the number of bytes of recordedFilename before processedString */
+        std::size_t recordedAsciiEnd; /* the number of leading bytes of recordedFilename which are printable ASCII */
+
+        /*
+         * A substring of the filename being aligned, and where it goes in the pattern.
+         */
+        struct AlignedChunk
+        {
+            std::size_t start; /* where the substring begins in alignedString (inclusive) */
+            std::size_t end; /* where the substring ends in alignedString (exclusive) */
+            std::uint64_t hash; /* the hash of the substring, as computed by ChunkColumn::hash */
+            std::size_t column; /* the column of the pattern as it was before the filename, that the substring goes
+                                   in, or goes in front of if inserted is set */
+            bool inserted; /* whether a new column is inserted for the substring */
+        };
+
+        /* the moves through the alignment table, each of which ends at a cell of it */
+        enum AlignMove
+        {
+            PLACE, /* a substring goes in the next column */
+            SKIP, /* the next column gets no substring */
+            INSERT /* a substring goes in a new column, in front of the next one */
+        };
+
+        /* scores used to align a filename's substrings with the columns of the pattern: a substring which is already
+           in a column scores, and anything else costs, least of all putting one in a column of many varied
+           substrings, i.e. of more than VARIED_COLUMN_SIZE of them */
+        static const int MATCH_SCORE = 4;
+        static const int MISMATCH_COST = 2;
+        static const int VARIED_MISMATCH_COST = 0;
+        static const int NEW_COLUMN_COST = 1;
+        static const int SKIP_COST = 2;
+        static const int INSERT_COST = 5;
+        static const std::size_t VARIED_COLUMN_SIZE = 8;
+
+        const uint8_t* alignedString; /* the string whose substrings are being aligned */
+        std::vector<AlignedChunk> alignedChunks; /* the substrings of the filename being aligned */
+        std::vector<int> alignScores; /* the best score of each cell of the alignment table, kept between filenames */
+        std::vector<AlignMove> alignMoves; /* the move that reached each cell of the alignment table with its best score */
+
+        /*
+         * Helper function for Summarizer::insertIngestedString.
+         * Collects a substring of the filename being aligned into alignedChunks.
+         * @param str the character buffer to take a substring of
+         * @param start where the substring in str begins (inclusive)
+         * @param end where the substring in str ends (exclusive)
+         */
+		void collectChunk(const uint8_t* str, std::size_t start, std::size_t end);
+
+        /*
+         * Helper function for Summarizer::insertIngestedString.
+         * Finds the best alignment of the substrings in alignedChunks against the columns of the pattern, and adds them
+         * to the pattern accordingly. The alignment is a dynamic program over a table of substrings by columns, of which
+         * only a band of 2 * options.alignBand + 1 cells around the diagonal is computed, so that aligning a filename
+         * costs O(substrings * options.alignBand) lookups. Columns past the end of the pattern are new ones, which,
+         * like in the unaligned pattern, any substring can go in.
+         */
+		void alignCollectedChunks();
+
+        /*
+         * Helper function for Summarizer::alignCollectedChunks.
+         * @param chunk a substring of the filename being aligned
+         * @param index the index of a column in pattern, or of a new column past its end
+         * @return the score of putting the substring in the column
+         */
+		int placementScore(const AlignedChunk& chunk, std::size_t index) const;
+
+        /*
+         * Helper function for Summarizer::insertIngestedString and Summarizer::placementScore.
+         * @param chunk a substring of the filename being aligned
+         * @param index the index of a column in pattern
+         * @return whether the column has the substring
+         */
+		bool columnHas(const AlignedChunk& chunk, std::size_t index) const;
+
+        /*
+         * Checks whether a grapheme cluster is one of the delimiters.
+         * @param s the bytes of the grapheme cluster
+         * @param n the number of bytes in the grapheme cluster
+         * @return true if the grapheme cluster is a delimiter; false otherwise
+         */
+		bool isDelimiter(const uint8_t* s, std::size_t n) const;
+
+        /*
+         * Makes sure that charBuffer can hold the grapheme breaks of a string.
+         * @param length the length of the string
+         * @return 0, or the errno value describing why charBuffer could not be grown, as recorded in status
+         */
+		int reserveGraphemeBreaks(std::size_t length);
 
         /*
          * (For use alongside SmartBuffer::getWriteableStringDoesNotUpdateStringLengthOrCapacity and
          * SmartBuffer::giveCapacityGetStringLength).
          * Checks whether result is the same buffer as the one contained by smartString.
          * If it is not, set smartString to contain result instead of its current buffer.
-         * Halts program if result is NULL, indicating an error.
+         * If result is NULL, indicating an error, records errno in status instead.
          * @param result buffer containing new data written by libunistring
          * @param smartString object which should wrap result
+         * @return 0, or the errno value recorded if result is NULL
+         */
+		template <class T> int checkResult(T* result, SmartBuffer<T>& smartString);
+
+        /*
+         * Records a failure in status, unless an earlier failure is recorded there already.
+         * @param error the errno value describing the failure
+         * @return error
+         */
+		int fail(int error);
+
+        /*
+         * A substring of the pattern, encoded in the user's locale and ready to be printed.
+         */
+        struct Cell
+        {
+            const char* bytes; /* the encoded substring */
+            std::size_t length; /* the number of bytes in the encoded substring */
+            int width; /* the number of columns required to display the substring on a terminal */
+        };
+
+        /*
+         * A column of the pattern as it was last rendered by Summarizer::renderSummary.
          */
-		template <class T> void checkResult(T* result, SmartBuffer<T>& smartString);
+        struct RenderedColumn
+        {
+            std::vector<Cell> cells; /* the column's substrings, sorted and encoded */
+            std::unique_ptr<ChunkArena> encodings; /* holds the substrings in cells that had to be re-encoded */
+            bool dirty; /* whether the column has changed since it was rendered, so that cells is out of date */
+
+            RenderedColumn() : dirty(true) {}
+        };
+
+        /* for each set in pattern, the set as it was last rendered */
+		std::vector<RenderedColumn> renderedColumns;
+
+        /*
+         * Helper function for Summarizer::renderSummary.
+         * Sorts the substrings in a column of the pattern, and encodes each one in the user's locale. Substrings which
+         * are already encoded correctly (e.g. all of them, in a utf-8 locale) are not copied.
+         * @param index the index of the column in pattern
+         * @param encodings arena to copy substrings into once they are re-encoded. Must outlive cells
+         * @param cells set to the encoded substrings of the column, in the order and with the counts of layout
+         * @return 0, or the errno value describing why a substring could not be encoded, as recorded in status
+         */
+		int encodeColumn(std::size_t index, ChunkArena& encodings, std::vector<Cell>& cells);
+
+        /*
+         * Helper function for Summarizer::encodeColumn.
+         * Puts the substrings of a column in the order of layout, leaving out all but the layout.top ones with the most
+         * filenames if there is a limit.
+         * @param items the substrings, which are reordered and truncated
+         * @param count returns the number of filenames which have an item
+         * @param less whether one item comes before another lexicographically
+         * @return the number of substrings left out
+         */
+		template <typename T, typename Count, typename Less>
+		std::size_t arrangeColumn(std::vector<T>& items, Count count, Less less) const;
+
+        /*
+         * Helper function for Summarizer::encodeColumn.
+         * Appends the number of filenames which have a substring to its cell, as layout.counts asks.
+         * @param cell the encoded substring
+         * @param count the number of filenames which have the substring in its column
+         * @param approximate whether count is only an estimate
+         * @param filenames the number of filenames in the pattern
+         * @param encodings arena to copy the annotated substring into. Must outlive cell
+         * @return 0, or the errno value describing why the count could not be encoded, as recorded in status
+         */
+		int annotateCell(Cell& cell, std::size_t count, bool approximate, std::size_t filenames, ChunkArena& encodings);
+
+        /*
+         * Helper function for Summarizer::encodeColumn.
+         * Encodes a line of utf-8 text which is not part of the pattern (e.g. a description) in the user's locale.
+         * @param text the line
+         * @param encodings arena to copy the line into. Must outlive cell
+         * @param cell set to the encoded line
+         * @return 0, or the errno value describing why the line could not be encoded, as recorded in status
+         */
+		int encodeText(const std::string& text, ChunkArena& encodings, Cell& cell);
+
+        /*
+         * Helper function for Summarizer::encodeColumn.
+         * Encodes a utf-8 substring in the user's locale, unless it already is encoded correctly.
+         * @param s the bytes of the substring
+         * @param n the number of bytes in the substring
+         * @param width the number of columns required to display the substring on a terminal
+         * @param encodings arena to copy the substring into once it is re-encoded. Must outlive cell
+         * @param cell set to the encoded substring
+         * @return 0, or the errno value describing why the substring could not be encoded, as recorded in status
+         */
+		int encodeCell(const uint8_t* s, std::size_t n, int width, ChunkArena& encodings, Cell& cell);
+
+        /*
+         * Helper function for Summarizer::encodeColumn.
+         * Describes a sketched column: its estimated number of unique substrings, e.g. "≈3.2M distinct".
+         * @param sketch the sketch of the column
+         * @return the description, in utf-8
+         */
+		std::string describeSketch(const ColumnSketch& sketch) const;
+
+        /*
+         * Replaces a set in the pattern with a sketch, seeded with every substring in the set and its occurrences.
+         * @param index the index of the set in pattern
+         */
+		void sketchColumn(std::size_t index);
+
+        /*
+         * Adds a new, empty set to the end of the pattern.
+         */
+		void addColumn();
+
+        /*
+         * Inserts a new, empty set into the pattern.
+         * @param index the index in pattern of the new set
+         */
+		void insertColumn(std::size_t index);
 
         /*
          * Adds the next substring of the currently-being-ingested filename to the next set in the pattern, and
@@ -206,6 +712,49 @@ class Summarizer
          * @param end where the substring in str ends (exclusive)
          */
 		void insertInNextColumn(const uint8_t* str, std::size_t start, std::size_t end);
+
+        /*
+         * Helper function for Summarizer::insertInNextColumn and Summarizer::recordInNextColumn.
+         * Adds a substring to the set at patternIndex, without moving on to the next set.
+         * @param s the bytes of a substring of the currently-being-ingested filename, within processedString
+         * @param n the number of bytes in the substring
+         * @return the index of the substring in the set, or SIZE_MAX if the set has been replaced by a sketch
+         */
+		std::size_t insertChunk(const uint8_t* s, std::size_t n);
+
+        /*
+         * Helper function for Summarizer::insertInNextColumn.
+         * @param s the bytes of a substring of the currently-being-ingested filename, within processedString
+         * @param n the number of bytes in the substring
+         * @return the number of columns required to display the substring on a terminal
+         */
+		int substringWidth(const uint8_t* s, std::size_t n);
+
+        /*
+         * Checks that a substring read back by Summarizer::deserialize could have been saved by
+         * Summarizer::serialize, i.e. that it is valid utf-8 without any NUL characters, and is as wide as it is in
+         * this locale.
+         * @param s the bytes of the substring, or nullptr if they could not be read
+         * @param n the number of bytes in the substring
+         * @param width the display width saved along with the substring
+         * @return whether the substring is valid
+         */
+		bool isValidSavedChunk(const uint8_t* s, std::size_t n, std::uint64_t width) const;
+
+        /*
+         * Takes one occurrence of the next substring of the currently-being-removed filename out of the next set in the
+         * pattern.
+         * @param str the character buffer to take a substring of
+         * @param start where the substring in str begins (inclusive)
+         * @param end where the substring in str ends (exclusive)
+         */
+		void removeFromNextColumn(const uint8_t* str, std::size_t start, std::size_t end);
+
+        /*
+         * Copies the substrings of every set in the pattern to a new arena, leaving out those which have been removed,
+         * and frees the old one.
+         */
+		void compactArena();
 };
 
 #endif /* SUMMARIZER_H */